@@ -0,0 +1,295 @@
+#include "batch.hpp"
+
+#include <meshproc.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <functional> // std::greater
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
+
+using namespace meshproc;
+
+struct Batch_File {
+  std::filesystem::path filepath;
+  uintmax_t size;
+};
+
+struct Mesh_Summary {
+  Input_Format format;
+  size_t num_triangles = 0;
+  std::optional<size_t> num_vertices; // Indexed formats only
+};
+
+// Matches '*' (any run of characters) and '?' (any character), with backtracking to the last '*'
+static bool matches_glob(std::string_view name, std::string_view pattern) {
+  size_t n = 0;
+  size_t p = 0;
+  size_t star_p = std::string_view::npos;
+  size_t star_n = 0;
+  while (n < name.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+      n++;
+      p++;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star_p = p++;
+      star_n = n;
+    } else if (star_p != std::string_view::npos) {
+      p = star_p + 1;
+      n = ++star_n;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') {
+    p++;
+  }
+  return p == pattern.size();
+}
+
+// Mesh caches written by --cache sit next to their source, they are not inputs
+static bool is_batch_candidate(const std::filesystem::directory_entry &entry) {
+  return entry.is_regular_file() && entry.path().extension() != ".meshcache";
+}
+
+static void expand_batch_input(const std::string &input, std::vector<Batch_File> &files) {
+  std::filesystem::path path(input);
+  std::string pattern = path.filename().string();
+  if (pattern.find_first_of("*?") != std::string::npos) {
+    std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : ".";
+    for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory)) {
+      if (is_batch_candidate(entry) && matches_glob(entry.path().filename().string(), pattern)) {
+        files.push_back({entry.path(), entry.file_size()});
+      }
+    }
+  } else if (std::filesystem::is_directory(path)) {
+    for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(path)) {
+      if (is_batch_candidate(entry)) {
+        files.push_back({entry.path(), entry.file_size()});
+      }
+    }
+  } else {
+    // Missing files are reported with the other per-file errors
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    files.push_back({path, error ? 0 : size});
+  }
+}
+
+static std::string_view get_input_format_name(Input_Format format) {
+  switch (format) {
+  case Input_Format::Binary_STL:
+    return "binary_stl";
+  case Input_Format::ASCII_STL:
+    return "ascii_stl";
+  case Input_Format::PLY:
+    return "ply";
+  case Input_Format::OBJ:
+    return "obj";
+  case Input_Format::OFF:
+    return "off";
+  case Input_Format::Unknown:
+    break;
+  }
+  return "unknown";
+}
+
+static Mesh_Summary load_indexed_mesh(std::span<const std::byte> bytes, Input_Format format) {
+  Indexed_Mesh mesh;
+  if (format == Input_Format::PLY) {
+    read_ply(bytes, mesh);
+  } else if (format == Input_Format::OBJ) {
+    read_obj(bytes, mesh);
+  } else {
+    read_off(bytes, mesh);
+  }
+  return {format, mesh.num_triangles(), mesh.vertices.size()};
+}
+
+// Loads the file the way the single file mode does without options: STL is streamed, other formats are indexed
+static Mesh_Summary summarize_mesh(std::span<const std::byte> bytes) {
+  Mesh_Summary summary{Input_Format::Unknown};
+  std::optional<Decompressing_Reader> decompressor;
+  std::vector<std::byte> decompressed_bytes;
+  if (Compression compression = detect_compression(bytes); compression != Compression::None) {
+    decompressor.emplace(bytes, compression);
+    summary.format = detect_streamed_input_format(decompressor->peek());
+    if (summary.format != Input_Format::Binary_STL && summary.format != Input_Format::ASCII_STL) {
+      decompressed_bytes = decompressor->read_all();
+      decompressor.reset();
+      bytes = decompressed_bytes;
+      summary.format = detect_input_format(bytes);
+    }
+  } else {
+    summary.format = detect_input_format(bytes);
+  }
+
+  if (bytes.empty()) {
+    return summary; // read_stl() would print "Empty file" in the middle of the JSON lines
+  }
+  if (summary.format == Input_Format::Binary_STL || summary.format == Input_Format::ASCII_STL) {
+    auto count_batch = [&](std::span<Triangle> batch) { summary.num_triangles += batch.size(); };
+    if (decompressor) {
+      read_stl(*decompressor, count_batch);
+    } else {
+      read_stl(bytes, count_batch);
+    }
+    return summary;
+  }
+  if (summary.format == Input_Format::Unknown) {
+    throw std::domain_error("Unsupported format");
+  }
+  return load_indexed_mesh(bytes, summary.format);
+}
+
+static void append_json_string(std::string &out, std::string_view s) {
+  out += '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out += std::format("\\u{:04x}", static_cast<unsigned>(c));
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+/* Runs task(i) for every i in [0, num_tasks) on `num_workers` threads. Tasks are dealt round-robin to one deque per
+ * worker, in the given order. A worker takes tasks from the front of its own deque, then steals from the back of the
+ * others' once it is empty. Tasks must not throw.
+ */
+template <typename F> static void run_work_stealing(size_t num_tasks, size_t num_workers, F &&task) {
+  struct Worker_Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+  std::vector<Worker_Queue> queues(num_workers);
+  for (size_t i = 0; i < num_tasks; i++) {
+    queues[i % num_workers].tasks.push_back(i);
+  }
+  auto take_task = [&](size_t worker) -> std::optional<size_t> {
+    for (size_t k = 0; k < num_workers; k++) {
+      Worker_Queue &queue = queues[(worker + k) % num_workers];
+      std::lock_guard lock(queue.mutex);
+      if (queue.tasks.empty()) {
+        continue;
+      }
+      size_t i;
+      if (k == 0) {
+        i = queue.tasks.front();
+        queue.tasks.pop_front();
+      } else {
+        i = queue.tasks.back();
+        queue.tasks.pop_back();
+      }
+      return i;
+    }
+    return std::nullopt; // No task is added once workers run, so every queue stays empty from now on
+  };
+  auto run_worker = [&](size_t worker) {
+    while (std::optional<size_t> i = take_task(worker)) {
+      task(*i);
+    }
+  };
+  std::vector<std::jthread> threads;
+  threads.reserve(num_workers - 1);
+  for (size_t worker = 1; worker < num_workers; worker++) {
+    threads.emplace_back(run_worker, worker);
+  }
+  run_worker(0);
+}
+
+int run_batch(const Batch_Options &options) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::string> inputs = options.inputs;
+  if (!options.manifest_filepath.empty()) {
+    std::ifstream manifest(options.manifest_filepath);
+    if (!manifest) {
+      std::cerr << "Failed to open manifest: " << options.manifest_filepath << std::endl;
+      return 1;
+    }
+    for (std::string line; std::getline(manifest, line);) {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (!line.empty() && !line.starts_with('#')) {
+        inputs.push_back(line);
+      }
+    }
+  }
+  // An input that cannot be listed, such as a glob in a missing directory, is reported like a file that failed to
+  // load and the other inputs still run
+  std::vector<Batch_File> files;
+  size_t num_failed_inputs = 0;
+  for (const std::string &input : inputs) {
+    try {
+      expand_batch_input(input, files);
+    } catch (const std::filesystem::filesystem_error &e) {
+      std::string line = "{\"path\":";
+      append_json_string(line, input);
+      line += ",\"error\":";
+      append_json_string(line, e.what());
+      line += '}';
+      std::cout << line << std::endl;
+      num_failed_inputs++;
+    }
+  }
+
+  // Largest files first, dealt round-robin: every worker starts on a big file and the small ones fill the gaps at the
+  // end, stolen by whichever worker is free
+  std::ranges::stable_sort(files, std::greater<>(), &Batch_File::size);
+  size_t num_workers = options.num_jobs > 0 ? options.num_jobs : std::max(1u, std::thread::hardware_concurrency());
+  num_workers = std::clamp(num_workers, size_t{1}, std::max(files.size(), size_t{1}));
+  // Loaders are parallel too, each worker gets its share of the hardware threads instead of one thread per hardware
+  // thread, which would start num_workers times too many
+  size_t threads_per_worker = std::max(size_t{1}, std::max(1u, std::thread::hardware_concurrency()) / num_workers);
+
+  std::mutex output_mutex;
+  std::atomic<size_t> num_failed = num_failed_inputs;
+  std::atomic<size_t> num_triangles = 0;
+  run_work_stealing(files.size(), num_workers, [&](size_t i) {
+    Scoped_Thread_Limit thread_limit(threads_per_worker);
+    std::string line = "{\"path\":";
+    append_json_string(line, files[i].filepath.string());
+    auto file_start = std::chrono::steady_clock::now();
+    try {
+      Mapped_File file(files[i].filepath.string());
+      Mesh_Summary summary = summarize_mesh(file.bytes());
+      std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - file_start;
+      line += std::format(",\"format\":\"{}\",\"triangles\":{}", get_input_format_name(summary.format),
+                          summary.num_triangles);
+      if (summary.num_vertices) {
+        line += std::format(",\"vertices\":{}", *summary.num_vertices);
+      }
+      line += std::format(",\"seconds\":{:.6f}", seconds.count());
+      num_triangles += summary.num_triangles;
+    } catch (const std::exception &e) {
+      line += ",\"error\":";
+      append_json_string(line, e.what());
+      num_failed++;
+    }
+    line += '}';
+    std::lock_guard lock(output_mutex);
+    std::cout << line << std::endl;
+  });
+
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+  std::cout << '{'
+            << std::format(R"("files":{},"failed":{},"triangles":{},"workers":{},"seconds":{:.6f})",
+                           files.size() + num_failed_inputs, num_failed.load(), num_triangles.load(), num_workers,
+                           seconds.count())
+            << '}' << std::endl;
+  return num_failed > 0 ? 1 : 0;
+}
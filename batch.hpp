@@ -0,0 +1,23 @@
+#pragma once
+
+/* Batch mode of meshproc: loads many files concurrently and reports each one as a JSON line */
+
+#include <string>
+#include <vector>
+
+struct Batch_Options {
+  /* Files, directories (searched recursively) and globs. Globs may only have wildcards ('*' and '?') in their last
+   * component, so that quoted patterns work without the shell expanding them.
+   */
+  std::vector<std::string> inputs;
+  std::string manifest_filepath; // Text file listing one input per line, optional
+  size_t num_jobs = 0;           // Files loaded at the same time, 0 for one per hardware thread
+};
+
+/* Prints one JSON line per file, in completion order:
+ *   {"path":"a.stl","format":"binary_stl","triangles":12,"seconds":0.000105}
+ *   {"path":"b.ply","error":"..."}
+ * then a summary line. Inputs that cannot be listed get an error line of their own, with the input as path. Returns
+ * the process exit code, 1 when any file or input failed.
+ */
+int run_batch(const Batch_Options &options);
@@ -0,0 +1,25 @@
+#pragma once
+
+/* Command line helpers shared by meshproc and meshproc_bench */
+
+#include <algorithm>
+#include <cctype> // std::tolower
+#include <charconv> // std::from_chars
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Based on: https://en.cppreference.com/mwiki/index.php?title=cpp/string/byte/tolower&oldid=152869#Notes
+inline std::string str_tolower(std::string s) {
+  std::ranges::transform(s, s.begin(), [](unsigned char c) { return std::tolower(c); }); // Thanks SonarLint!
+  return s;
+}
+
+inline std::optional<size_t> parse_count(std::string_view text) {
+  size_t value;
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc() || end != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
@@ -0,0 +1,681 @@
+#pragma once
+
+/* Public interface of the meshproc_core library: mesh types and the STL and PLY loaders, plus the processing steps
+ * (welding, structure of arrays conversion, normals, bounds) and the parametric mesh generator built on top of them.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <exception>
+#include <filesystem>
+#include <functional> // std::equal_to, std::function
+#include <iosfwd>
+#include <limits>
+#include <memory> // std::unique_ptr
+#include <memory_resource>
+#include <new> // std::align_val_t
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace meshproc {
+
+constexpr size_t BINARY_STL_HEADER_SIZE = 80;
+
+struct Vec3f {
+  float x;
+  float y;
+  float z;
+
+  Vec3f cross(const Vec3f &other) const {
+    return Vec3f{
+        y * other.z - z * other.y,
+        z * other.x - x * other.z,
+        x * other.y - y * other.x,
+    };
+  }
+
+  Vec3f operator/(float s) const { return Vec3f{x / s, y / s, z / s}; }
+  friend Vec3f operator/(float s, const Vec3f &v) { return Vec3f{s / v.x, s / v.y, s / v.z}; }
+  Vec3f operator*(float s) const { return Vec3f{x * s, y * s, z * s}; }
+  friend Vec3f operator*(float s, const Vec3f &v) { return v * s; }
+  float calc_magnitude() const { return std::sqrt(x * x + y * y + z * z); }
+  // Zero vectors are left as they are instead of turning into NaNs
+  void normalize() {
+    float m = calc_magnitude();
+    if (m == 0.0f) {
+      return;
+    }
+    float inverse_m = 1.0f / m;
+    x *= inverse_m;
+    y *= inverse_m;
+    z *= inverse_m;
+  }
+  Vec3f operator-(const Vec3f &other) const { return Vec3f{x - other.x, y - other.y, z - other.z}; }
+  Vec3f operator+(const Vec3f &other) const { return Vec3f{x + other.x, y + other.y, z + other.z}; }
+};
+
+struct Triangle {
+  Vec3f normal;
+  std::array<Vec3f, 3> vertices;
+};
+
+// Shared vertex buffer, every three consecutive indices form a triangle
+struct Indexed_Mesh {
+  std::vector<Vec3f> vertices;
+  std::vector<uint32_t> indices;
+
+  size_t num_triangles() const { return indices.size() / 3; }
+};
+
+static_assert(sizeof(Triangle) == 48, "Triangle must match the layout of a binary STL record (without attributes)");
+
+// Each binary STL record is a Triangle followed by a 2 bytes "attribute byte count"
+constexpr size_t BINARY_STL_RECORD_SIZE = sizeof(Triangle) + sizeof(uint16_t);
+
+/* Read-only memory mapping of a whole file, the mapping is released on destruction.
+ * Empty files are not mapped at all (mapping zero bytes is an error on most platforms), bytes() is then empty.
+ * Throws std::system_error when the file cannot be opened or mapped.
+ */
+class Mapped_File {
+public:
+  explicit Mapped_File(const std::string &filepath);
+
+  Mapped_File(const Mapped_File &) = delete;
+  Mapped_File &operator=(const Mapped_File &) = delete;
+
+  ~Mapped_File() { release(); }
+
+  std::span<const std::byte> bytes() const { return {data_, size_}; }
+
+private:
+  const std::byte *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void *file_ = nullptr; // HANDLE, kept opaque so this header does not pull in windows.h
+  void *mapping_ = nullptr;
+#endif
+
+  void release();
+  [[noreturn]] void throw_last_error(const std::string &filepath);
+};
+
+/* Zero-copy view over the records of a binary STL file.
+ * Records are 50 bytes apart so their floats are not necessarily aligned, triangles are therefore copied out
+ * (a 48 bytes memcpy, which compiles down to a few unaligned loads) instead of being reinterpreted in place.
+ */
+class Binary_STL_View {
+public:
+  // Returns std::nullopt when the data size does not match the triangle count stored after the header
+  static std::optional<Binary_STL_View> from_bytes(std::span<const std::byte> bytes) {
+    if (bytes.size() < BINARY_STL_HEADER_SIZE + sizeof(uint32_t)) {
+      return std::nullopt;
+    }
+    uint32_t num_triangles;
+    std::memcpy(&num_triangles, bytes.data() + BINARY_STL_HEADER_SIZE, sizeof(uint32_t));
+    if (bytes.size() != BINARY_STL_HEADER_SIZE + sizeof(uint32_t) + num_triangles * BINARY_STL_RECORD_SIZE) {
+      return std::nullopt;
+    }
+    return Binary_STL_View(bytes.data() + BINARY_STL_HEADER_SIZE + sizeof(uint32_t), num_triangles);
+  }
+
+  size_t size() const { return num_triangles_; }
+
+  Triangle operator[](size_t i) const {
+    Triangle t;
+    std::memcpy(&t, records_ + i * BINARY_STL_RECORD_SIZE, sizeof(Triangle));
+    return t;
+  }
+
+  uint16_t attribute_byte_count(size_t i) const {
+    uint16_t count;
+    std::memcpy(&count, records_ + i * BINARY_STL_RECORD_SIZE + sizeof(Triangle), sizeof(uint16_t));
+    return count;
+  }
+
+  // Lazy range of triangles, nothing is copied until an element is dereferenced. Holds a copy of the view (two
+  // pointers) so it stays valid when iterating over a temporary view
+  auto triangles() const {
+    return std::views::iota(size_t{0}, num_triangles_) |
+           std::views::transform([view = *this](size_t i) { return view[i]; });
+  }
+
+  // Single pass bulk copy of all records, appended to `triangles` with one allocation
+  void unpack(std::vector<Triangle> &triangles) const {
+    size_t offset = triangles.size();
+    triangles.resize(offset + num_triangles_);
+    Triangle *dst = triangles.data() + offset;
+    for (size_t i = 0; i < num_triangles_; i++) {
+      std::memcpy(dst + i, records_ + i * BINARY_STL_RECORD_SIZE, sizeof(Triangle));
+    }
+  }
+
+private:
+  Binary_STL_View(const std::byte *records, size_t num_triangles) : records_(records), num_triangles_(num_triangles) {}
+
+  const std::byte *records_;
+  size_t num_triangles_;
+};
+
+/* Threading
+ *
+ * Loaders, writers and processing steps split large inputs across up to one thread per hardware thread. Callers that
+ * already run several of them concurrently, such as workers each loading their own file, cap them instead so that the
+ * machine is not oversubscribed.
+ */
+
+/* Caps the threads used by the meshproc calls made from the constructing thread until destruction, the previous cap is
+ * then restored. 1 runs everything on the calling thread, 0 is treated as 1.
+ */
+class Scoped_Thread_Limit {
+public:
+  explicit Scoped_Thread_Limit(size_t max_threads);
+  ~Scoped_Thread_Limit();
+
+  Scoped_Thread_Limit(const Scoped_Thread_Limit &) = delete;
+  Scoped_Thread_Limit &operator=(const Scoped_Thread_Limit &) = delete;
+
+private:
+  size_t previous_max_threads_;
+};
+
+/* Streaming
+ *
+ * Readers taking a Triangle_Sink never hold the whole triangle soup: triangles are delivered in file order, in batches
+ * of TRIANGLE_BATCH_SIZE (the last one may be smaller). The batch buffer is reused once the sink returns, the sink may
+ * modify it in place but must copy out whatever it keeps.
+ */
+
+constexpr size_t TRIANGLE_BATCH_SIZE = 1 << 16;
+
+using Triangle_Sink = std::function<void(std::span<Triangle> batch)>;
+
+/* Format detection
+ *
+ * Input files are recognized by their content rather than their name, so extensionless files and piped data load the
+ * same way. Only the first INPUT_FORMAT_SNIFF_SIZE bytes are looked at, plus the total size for binary STL.
+ */
+
+constexpr size_t INPUT_FORMAT_SNIFF_SIZE = 4096;
+
+enum class Input_Format {
+  Unknown,
+  Binary_STL,
+  ASCII_STL,
+  PLY, // ASCII or binary, the header tells
+  OBJ,
+  OFF,
+};
+
+/* Binary STL is checked first: its header is free-form and often starts with "solid" too. Blank lines and '#'
+ * comments are skipped before the text signatures, empty input is Input_Format::Unknown.
+ */
+Input_Format detect_input_format(std::span<const std::byte> bytes);
+/* Same as detect_input_format() from the first bytes of data whose total size is not known yet, such as decompressed
+ * input. Binary STL is then told from text by the control characters in its records.
+ */
+Input_Format detect_streamed_input_format(std::span<const std::byte> prefix);
+
+/* Compressed input
+ *
+ * gzip and zstd data are recognized by their magic bytes. Support for each is optional at build time, depending on
+ * whether zlib and libzstd were found. The header of a binary STL is free-form and may start with the same bytes, so
+ * data whose size matches a binary STL is never taken for compressed data.
+ */
+
+enum class Compression {
+  None,
+  Gzip,
+  Zstd,
+};
+
+Compression detect_compression(std::span<const std::byte> bytes);
+
+/* Decompresses data on a background thread, handing it over in chunks of DECOMPRESSION_CHUNK_SIZE bytes (the last one
+ * may be smaller) while the caller parses the previous ones. The decompressor runs at most DECOMPRESSION_QUEUE_SIZE
+ * chunks ahead. `bytes` must outlive the reader. Errors of the background thread, such as corrupted or truncated
+ * data, are rethrown by peek(), next_chunk() and read_all(); the constructor throws std::domain_error when the
+ * decompressor was not built in.
+ */
+class Decompressing_Reader {
+public:
+  static constexpr size_t DECOMPRESSION_CHUNK_SIZE = 4 << 20;
+  static constexpr size_t DECOMPRESSION_QUEUE_SIZE = 4;
+
+  Decompressing_Reader(std::span<const std::byte> bytes, Compression compression);
+
+  Decompressing_Reader(const Decompressing_Reader &) = delete;
+  Decompressing_Reader &operator=(const Decompressing_Reader &) = delete;
+
+  // Stops the decompression if it is not done yet
+  ~Decompressing_Reader();
+
+  // The chunk next_chunk() will return, without consuming it. Empty at the end of the data
+  std::span<const std::byte> peek();
+  /* Replaces `chunk` with the next chunk, the previous content of `chunk` is recycled as a decompression buffer.
+   * Returns false at the end of the data.
+   */
+  bool next_chunk(std::vector<std::byte> &chunk);
+  // The remaining chunks in one buffer
+  std::vector<std::byte> read_all();
+
+private:
+  struct State;
+  std::unique_ptr<State> state_;
+};
+
+/* STL loading
+ *
+ * Binary files are recognized by their size matching the triangle count stored after the header, anything else is
+ * parsed as ASCII. An empty file prints "Empty file" and loads nothing. Overloads taking a vector append to it.
+ */
+
+// Reference reader going through an input stream, kept for comparison with the mapped readers
+void read_stl(std::ifstream &ifs, std::vector<Triangle> &triangles);
+void read_stl(std::span<const std::byte> bytes, std::vector<Triangle> &triangles);
+void read_stl(std::span<const std::byte> bytes, const Triangle_Sink &sink);
+void read_binary_stl(const Binary_STL_View &view, const Triangle_Sink &sink);
+/* Streams decompressed STL as it is decompressed. Binary and ASCII are told apart with
+ * detect_streamed_input_format(), a binary STL whose size does not match its triangle count throws std::domain_error.
+ */
+void read_stl(Decompressing_Reader &reader, const Triangle_Sink &sink);
+/* The text is split at "facet" keywords into one chunk per thread, chunks are parsed in parallel then passed on in
+ * file order. Large files are processed a window of chunks at a time, so at most a few MB of triangles per thread are
+ * held before being handed over.
+ */
+void read_ascii_stl(std::string_view text, std::vector<Triangle> &triangles);
+void read_ascii_stl(std::string_view text, const Triangle_Sink &sink);
+
+/* STL writing, existing files are overwritten. Records are formatted in parallel; the binary writer builds the whole
+ * file in memory and writes it at once, the ASCII writer uses std::to_chars and writes batches of facets.
+ */
+
+// Throws std::length_error when there are more triangles than a binary STL can count
+void write_binary_stl(std::span<const Triangle> triangles, const std::filesystem::path &filepath);
+void write_ascii_stl(std::span<const Triangle> triangles, const std::filesystem::path &filepath);
+
+/* PLY loading */
+
+enum class PLY_Scalar_Type {
+  Char,
+  UChar,
+  Short,
+  UShort,
+  Int,
+  UInt,
+  Float,
+  Double,
+};
+
+struct String_Hash {
+  using is_transparent =
+      void; // enable "heterogeneous lookup" for this hash to avoid creating temporary strings, thanks SonarLint!
+  size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+template <typename T> using String_Map = std::unordered_map<std::string, T, String_Hash, std::equal_to<>>;
+template <typename T>
+using PMR_String_Map = std::pmr::unordered_map<std::pmr::string, T, String_Hash, std::equal_to<>>;
+
+// One alternative per PLY scalar type, in PLY_Scalar_Type order
+using PLY_Values =
+    std::variant<std::pmr::vector<int8_t>, std::pmr::vector<uint8_t>, std::pmr::vector<int16_t>,
+                 std::pmr::vector<uint16_t>, std::pmr::vector<int32_t>, std::pmr::vector<uint32_t>,
+                 std::pmr::vector<float>, std::pmr::vector<double>>;
+
+/* Column of one property across all elements of an element definition, values keep their declared type so a float
+ * property takes 4 bytes per element.
+ * Scalar properties hold one value per element. List properties concatenate the lists of all elements, the list of
+ * element i is values[offsets[i]] up to values[offsets[i + 1]].
+ */
+struct PLY_Property {
+  PLY_Values values;
+  std::pmr::vector<size_t> offsets; // List properties only, has one entry per element plus one
+
+  explicit PLY_Property(std::pmr::memory_resource *resource) : offsets(resource) {}
+
+  size_t size() const {
+    return std::visit([](const auto &typed_values) { return typed_values.size(); }, values);
+  }
+
+  /* Returns the values as T. This is free when T is the declared type, otherwise the values are converted into
+   * `storage` and the returned span points there.
+   */
+  template <typename T> std::span<const T> values_as(std::vector<T> &storage) const {
+    if (const auto *typed_values = std::get_if<std::pmr::vector<T>>(&values)) {
+      return *typed_values;
+    }
+    std::visit(
+        [&](const auto &typed_values) {
+          storage.resize(typed_values.size());
+          std::ranges::transform(typed_values, storage.begin(), [](auto value) { return static_cast<T>(value); });
+        },
+        values);
+    return storage;
+  }
+
+  // List of element i, `typed_values` being the result of values_as()
+  template <typename T> std::span<const T> list(std::span<const T> typed_values, size_t i) const {
+    return typed_values.subspan(offsets[i], offsets[i + 1] - offsets[i]);
+  }
+};
+
+// All elements sharing one element definition, stored column by column
+struct PLY_Element {
+  size_t count = 0;
+  PMR_String_Map<PLY_Property> property_map;
+
+  explicit PLY_Element(std::pmr::memory_resource *resource) : property_map(resource) {}
+};
+
+/* Every map, name and column is allocated from `arena`, which grows by large blocks and is released in one shot with
+ * the Parsed_PLY instead of one free per node and column. The arena is boxed so that moving keeps it in place, but
+ * assigning would free the memory of the maps before they are replaced, so it is not allowed.
+ */
+struct Parsed_PLY {
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena = std::make_unique<std::pmr::monotonic_buffer_resource>();
+  PMR_String_Map<PLY_Element> elements_map{arena.get()};
+
+  Parsed_PLY() = default;
+  Parsed_PLY(Parsed_PLY &&) = default;
+  Parsed_PLY &operator=(Parsed_PLY &&) = delete;
+};
+
+class PLY_Expected_Element_Definition_Error : public std::exception {
+public:
+  const char *what() const throw() final {
+    return "Expected at least one element definition before property definition";
+  }
+};
+
+class PLY_Unexpected_End_Of_Data_Error : public std::exception {
+public:
+  const char *what() const throw() final { return "Unexpected end of data in binary PLY body"; }
+};
+
+// Parses every element of an ascii, binary_little_endian or binary_big_endian PLY file
+Parsed_PLY read_ply(std::span<const std::byte> bytes);
+/* Appends the "vertex" and "face" elements to `mesh`, faces index into the vertices of this file only. Polygonal
+ * faces are triangulated: fanned when convex, ear clipped otherwise.
+ */
+void read_ply(std::span<const std::byte> bytes, Indexed_Mesh &mesh);
+// Appends the faces as a triangle soup, normals are computed from the winding order
+void read_ply(std::span<const std::byte> bytes, std::vector<Triangle> &triangles);
+/* Streams the faces as triangles, normals are computed from the winding order. Only the indexed vertex and face
+ * columns are held in memory, not the expanded triangles.
+ */
+void read_ply(std::span<const std::byte> bytes, const Triangle_Sink &sink);
+
+/* OBJ loading
+ *
+ * Vertex positions and faces only, texture coordinates, normals, groups and materials are skipped. Polygonal faces
+ * are fan-triangulated. The file is split into line-aligned chunks parsed in parallel, vertex references (1-based,
+ * or negative to count back from the last vertex) are resolved once the vertex count of every chunk is known.
+ */
+
+// Appends the vertices and faces to `mesh`, faces index into the vertices of this file only
+void read_obj(std::span<const std::byte> bytes, Indexed_Mesh &mesh);
+// Appends the faces as a triangle soup, normals are computed from the winding order
+void read_obj(std::span<const std::byte> bytes, std::vector<Triangle> &triangles);
+void read_obj(std::span<const std::byte> bytes, const Triangle_Sink &sink);
+
+/* OFF loading
+ *
+ * OFF, COFF, NOFF, STOFF, 4OFF (homogeneous coordinates) and nOFF files, the latter with 3 dimensions only. Only
+ * positions and faces are kept, polygonal faces are fan-triangulated while they are read, straight into the indexed
+ * layout.
+ */
+
+// Appends the vertices and faces to `mesh`, faces index into the vertices of this file only
+void read_off(std::span<const std::byte> bytes, Indexed_Mesh &mesh);
+// Appends the faces as a triangle soup, normals are computed from the winding order
+void read_off(std::span<const std::byte> bytes, std::vector<Triangle> &triangles);
+void read_off(std::span<const std::byte> bytes, const Triangle_Sink &sink);
+
+/* PLY writing */
+
+// Optional per-vertex attributes of write_binary_ply(), each one is either empty or has one entry per vertex
+struct PLY_Vertex_Attributes {
+  std::span<const Vec3f> normals;                 // Written as nx, ny, nz floats
+  std::span<const std::array<uint8_t, 3>> colors; // Written as red, green, blue uchars
+};
+
+/* Writes a binary_little_endian PLY file, faces are "vertex_indices" lists of uchar count and uint indices. Records
+ * are stored in parallel into large buffers, each written at once. Existing files are overwritten.
+ * Throws std::invalid_argument when an attribute does not have one entry per vertex.
+ */
+void write_binary_ply(const Indexed_Mesh &mesh, const std::filesystem::path &filepath,
+                      const PLY_Vertex_Attributes &attributes = {});
+
+/* Merges triangle corners closer than `epsilon` (exactly equal positions when epsilon is 0) into shared vertices.
+ * With a non-zero epsilon a corner is merged into the first vertex within epsilon of it, vertices being the corners
+ * that were not merged themselves, so no corner moves further than epsilon. Vertices are numbered in order of first
+ * occurrence.
+ */
+Indexed_Mesh weld_vertices(std::span<const Triangle> triangles, float epsilon = 0.0f);
+
+/* Structure of arrays storage
+ *
+ * Vec3f and Triangle interleave coordinates, so vectorized loops over them need gathers. The containers below keep
+ * each coordinate in its own array, aligned to and padded up to a multiple of SIMD_WIDTH so kernels can always load
+ * full registers. Padding elements are zero.
+ */
+
+constexpr size_t SIMD_WIDTH = 8; // Floats per AVX register
+constexpr size_t SIMD_ALIGNMENT = SIMD_WIDTH * sizeof(float);
+
+template <typename T, size_t Alignment> struct Aligned_Allocator {
+  using value_type = T;
+  template <typename U> struct rebind {
+    using other = Aligned_Allocator<U, Alignment>;
+  };
+
+  Aligned_Allocator() = default;
+  template <typename U> Aligned_Allocator(const Aligned_Allocator<U, Alignment> &) {}
+
+  T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment))); }
+  void deallocate(T *p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+
+  template <typename U> bool operator==(const Aligned_Allocator<U, Alignment> &) const { return true; }
+};
+
+using Aligned_Floats = std::vector<float, Aligned_Allocator<float, SIMD_ALIGNMENT>>;
+
+inline size_t calc_padded_size(size_t size) { return (size + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH; }
+
+struct SoA_Vec3_Array {
+  Aligned_Floats x;
+  Aligned_Floats y;
+  Aligned_Floats z;
+
+  // Number of actual elements, the arrays themselves are padded
+  size_t size() const { return size_; }
+
+  void resize(size_t size) {
+    size_ = size;
+    for (Aligned_Floats *coordinates : {&x, &y, &z}) {
+      coordinates->resize(calc_padded_size(size));
+      std::fill(coordinates->begin() + size, coordinates->end(), 0.0f);
+    }
+  }
+
+  Vec3f operator[](size_t i) const { return {x[i], y[i], z[i]}; }
+
+  void set(size_t i, const Vec3f &v) {
+    x[i] = v.x;
+    y[i] = v.y;
+    z[i] = v.z;
+  }
+
+private:
+  size_t size_ = 0;
+};
+
+struct SoA_Triangles {
+  std::array<SoA_Vec3_Array, 3> corners;
+  SoA_Vec3_Array normals;
+
+  size_t size() const { return normals.size(); }
+
+  void resize(size_t size) {
+    for (SoA_Vec3_Array &corner : corners) {
+      corner.resize(size);
+    }
+    normals.resize(size);
+  }
+};
+
+SoA_Vec3_Array to_soa(std::span<const Vec3f> vertices);
+SoA_Triangles to_soa(std::span<const Triangle> triangles);
+void to_aos(const SoA_Triangles &soa, std::vector<Triangle> &triangles);
+
+struct Bounds {
+  Vec3f min{std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(),
+            std::numeric_limits<float>::infinity()};
+  Vec3f max{-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+            -std::numeric_limits<float>::infinity()};
+
+  void extend(const Bounds &other) {
+    min = {std::min(min.x, other.min.x), std::min(min.y, other.min.y), std::min(min.z, other.min.z)};
+    max = {std::max(max.x, other.max.x), std::max(max.y, other.max.y), std::max(max.z, other.max.z)};
+  }
+};
+
+Bounds calc_bounds(const SoA_Vec3_Array &points);
+Bounds calc_bounds(const SoA_Triangles &triangles);
+
+// Row-major 3x4 affine transform, the last column is the translation
+using Affine_Transform = std::array<std::array<float, 4>, 3>;
+
+void apply_transform(SoA_Vec3_Array &points, const Affine_Transform &m);
+
+/* Face normals
+ *
+ * Normals are recomputed from the winding order with the widest SIMD kernel supported by the CPU, to about 22 bits of
+ * precision. Zero-area faces get a zero normal.
+ */
+
+void compute_face_normals(SoA_Triangles &triangles);
+// Overwrites the normals of AoS triangles, converting them to SoA one small block at a time per thread
+void recompute_normals(std::span<Triangle> triangles);
+// Expands an indexed mesh into a triangle soup, normals are computed from the winding order
+void append_triangle_soup(const Indexed_Mesh &mesh, std::vector<Triangle> &triangles);
+// Same as append_triangle_soup() but one batch at a time
+void stream_triangle_soup(const Indexed_Mesh &mesh, const Triangle_Sink &sink);
+
+/* Mesh cache
+ *
+ * Native binary format holding a loaded mesh, so later runs map it and use it in place instead of parsing the source
+ * file again. Layout: a header (magic, format version, source key, section offsets and sizes, checksum) followed by
+ * the vertex, index and face normal sections, each aligned to MESH_CACHE_ALIGNMENT bytes. Values are stored in native
+ * byte order; caches written on a host of the other byte order are rejected like stale ones.
+ */
+
+constexpr uint32_t MESH_CACHE_VERSION = 1;
+constexpr size_t MESH_CACHE_ALIGNMENT = 64;
+
+// Identifies the version of the source file a cache was built from
+struct Mesh_Cache_Key {
+  uint64_t source_size = 0;
+  int64_t source_mtime = 0; // Ticks of std::filesystem::file_time_type
+
+  bool operator==(const Mesh_Cache_Key &) const = default;
+};
+
+Mesh_Cache_Key calc_mesh_cache_key(const std::filesystem::path &source_filepath);
+// The cache lives next to its source file, with ".meshcache" appended to the file name
+std::filesystem::path get_mesh_cache_path(const std::filesystem::path &source_filepath);
+
+/* `face_normals` is either empty or has one normal per triangle. The cache is written to a temporary file first then
+ * renamed, so concurrent readers never see a partial cache.
+ */
+void write_mesh_cache(const Indexed_Mesh &mesh, std::span<const Vec3f> face_normals, const Mesh_Cache_Key &key,
+                      const std::filesystem::path &filepath);
+
+// Zero-copy view over the sections of a mapped cache file
+class Mesh_Cache_View {
+public:
+  /* Returns std::nullopt when the bytes are not a valid cache of the current version, were built from another
+   * version of the source (`key` mismatch) or fail the checksum
+   */
+  static std::optional<Mesh_Cache_View> from_bytes(std::span<const std::byte> bytes, const Mesh_Cache_Key &key);
+
+  std::span<const Vec3f> vertices() const { return vertices_; }
+  std::span<const uint32_t> indices() const { return indices_; }
+  std::span<const Vec3f> face_normals() const { return face_normals_; } // Empty when the cache has none
+  size_t num_triangles() const { return indices_.size() / 3; }
+
+  Indexed_Mesh to_indexed_mesh() const;
+  // Expands the mesh into a triangle soup, normals are the cached ones or computed from the winding order
+  void append_triangle_soup(std::vector<Triangle> &triangles) const;
+
+private:
+  Mesh_Cache_View(std::span<const Vec3f> vertices, std::span<const uint32_t> indices,
+                  std::span<const Vec3f> face_normals)
+      : vertices_(vertices), indices_(indices), face_normals_(face_normals) {}
+
+  std::span<const Vec3f> vertices_;
+  std::span<const uint32_t> indices_;
+  std::span<const Vec3f> face_normals_;
+};
+
+/* Parametric mesh generation
+ *
+ * Generated meshes compute any vertex or triangle from its index, so they are written in parallel batches without
+ * ever holding the whole mesh in memory. Every shape is made of grids of quads, each split into two triangles:
+ * spheres are cubes of 6 grids projected on the unit sphere (vertices on the cube edges are duplicated), tori are one
+ * grid wrapping around in both directions and terrains are one grid of value noise heights.
+ */
+
+enum class Generated_Shape {
+  Sphere,
+  Torus,
+  Terrain,
+};
+
+std::optional<Generated_Shape> parse_generated_shape(std::string_view name);
+
+class Parametric_Mesh {
+public:
+  // The actual triangle count is the closest one the shape's grids allow, see num_triangles()
+  Parametric_Mesh(Generated_Shape shape, size_t num_triangles);
+
+  size_t num_vertices() const { return num_grids() * vertex_rows() * vertex_columns(); }
+  size_t num_triangles() const { return num_grids() * rows() * columns() * 2; }
+
+  Vec3f vertex(size_t i) const;
+  std::array<uint32_t, 3> triangle(size_t i) const;
+  Triangle expanded_triangle(size_t i) const;
+
+private:
+  size_t num_grids() const { return shape_ == Generated_Shape::Sphere ? 6 : 1; }
+  size_t rows() const { return resolution_; }
+  size_t columns() const { return shape_ == Generated_Shape::Torus ? 2 * resolution_ : resolution_; }
+  // Wrapping grids reuse their first row and column instead of closing with an extra one
+  size_t vertex_rows() const { return shape_ == Generated_Shape::Torus ? rows() : rows() + 1; }
+  size_t vertex_columns() const { return shape_ == Generated_Shape::Torus ? columns() : columns() + 1; }
+
+  Generated_Shape shape_;
+  size_t resolution_;
+};
+
+enum class Mesh_File_Format {
+  Binary_STL,
+  ASCII_STL,
+  ASCII_PLY,
+  Binary_PLY,
+};
+
+void write_parametric_mesh(const Parametric_Mesh &mesh, Mesh_File_Format format,
+                           const std::filesystem::path &filepath);
+
+} // namespace meshproc
@@ -1,308 +1,361 @@
-#include <algorithm> // std::transform
-#include <array>
+#include "batch.hpp"
+#include "cli_utils.hpp"
+
+#include <meshproc.hpp>
+
+#include <algorithm>
+#include <cerrno>
 #include <charconv> // std::from_chars
-#include <cmath>
-#include <cstddef> // size_t
-#include <cstdint>
-#include <exception>
+#include <cstdio> // std::fread
 #include <format>
-#include <fstream>
-#include <functional> // std::equal_to
-#include <iomanip>    // std::quoted
 #include <iostream>
-#include <limits>
-#include <ranges>
+#include <optional>
+#include <span>
 #include <string>
-#include <string_view>
-#include <unordered_map>
+#include <system_error>
 #include <vector>
 
-constexpr size_t BINARY_STL_HEADER_SIZE = 80;
-
-struct Vec3f {
-  float x;
-  float y;
-  float z;
-
-  Vec3f cross(const Vec3f &other) const {
-    return Vec3f{
-        y * other.z - z * other.y,
-        z * other.x - x * other.z,
-        x * other.y - y * other.x,
-    };
-  }
-
-  Vec3f operator/(float s) const { return Vec3f{x / s, y / s, z / s}; }
-  friend Vec3f operator/(float s, const Vec3f &v) { return Vec3f{s / v.x, s / v.y, s / v.z}; }
-  Vec3f operator*(float s) const { return Vec3f{x * s, y * s, z * s}; }
-  friend Vec3f operator*(float s, const Vec3f &v) { return v * s; }
-  float calc_magnitude() const { return std::sqrt(x * x + y * y + z * z); }
-  void normalize() {
-    float m = calc_magnitude();
-    x /= m;
-    y /= m;
-    z /= m;
-  }
-  Vec3f operator-(const Vec3f &other) const { return Vec3f{x - other.x, y - other.y, z - other.z}; }
-  Vec3f operator+(const Vec3f &other) const { return Vec3f{x + other.x, y + other.y, z + other.z}; }
-};
-
-struct Triangle {
-  Vec3f normal;
-  std::array<Vec3f, 3> vertices;
-};
-
-struct PLY_Property_Definition {
-  enum class Type {
-    List,
-    Scalar,
-  };
-  Type type;
-  std::string name;
-};
-
-struct PLY_Element_Definition {
-  std::string name;
-  size_t count;
-  std::vector<PLY_Property_Definition> property_definitions;
-};
-
-struct String_Hash {
-  using is_transparent =
-      void; // enable "heterogeneous lookup" for this hash to avoid creating temporary strings, thanks SonarLint!
-  size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
-};
-
-template <typename T> using String_Map = std::unordered_map<std::string, T, String_Hash, std::equal_to<>>;
-
-struct PLY_Property {
-  /* scalar properties are vectors of size 1, list properties are larger
-   * a double should be able to hold all types of numeric data supported by PLY specification
-   */
-  std::vector<double> values;
-};
-
-struct PLY_Element {
-  String_Map<PLY_Property> property_map;
-};
-
-struct Parsed_PLY {
-  String_Map<std::vector<PLY_Element>> elements_map;
-};
-
-class PLY_Expected_Element_Definition_Error : public std::exception {
-public:
-  const char *what() const throw() final {
-    return "Expected at least one element definition before property definition";
-  }
+#ifdef _WIN32
+#include <fcntl.h> // _O_BINARY
+#include <io.h> // _setmode
+#endif
+
+using namespace meshproc;
+
+struct Options {
+  std::string filepath;
+  bool weld = false;
+  float weld_epsilon = 0.0f;
+  bool print_bounds = false;
+  bool recompute_normals = false;
+  std::optional<Generated_Shape> generated_shape; // Write this shape to `filepath` instead of reading it
+  size_t generated_triangles = 1'000'000;
+  bool ascii = false;
+  std::string output_filepath; // Also write the loaded mesh there
+  bool use_cache = false;
+  bool batch = false; // Load `batch_options.inputs` instead of `filepath`, only --jobs and --manifest apply
+  Batch_Options batch_options;
 };
 
-static void read_binary_stl(uint32_t num_triangles, std::ifstream &ifs, std::vector<Triangle> &triangles) {
-  triangles.reserve(triangles.size() + num_triangles);
-  for (uint32_t i = 0; i < num_triangles; ++i) {
-    Triangle t;
-    ifs.read((char *)&t, sizeof(Triangle));
-    triangles.push_back(t);
-    uint16_t attribute_byte_count;
-    ifs.read((char *)&attribute_byte_count, sizeof(uint16_t));
-  }
-}
-
-static void read_ascii_stl(std::ifstream &ifs, std::vector<Triangle> &triangles) {
-  while (ifs.good()) {
-    std::string token;
-    ifs >> token;
-    if (token == "facet") {
-      Triangle t;
-      ifs >> token; // expecting "normal"
-      ifs >> t.normal.x >> t.normal.y >> t.normal.z;
-      ifs >> token; // expecting "outer"
-      ifs >> token; // expecting "loop"
-      for (int i = 0; i < 3; i++) {
-        ifs >> token; // expecting "vertex"
-        ifs >> t.vertices[i].x >> t.vertices[i].y >> t.vertices[i].z;
+// Returns std::nullopt when the arguments are invalid
+static std::optional<Options> parse_options(std::span<char *> args) {
+  Options options;
+  for (std::string_view arg : args) {
+    if (arg == "--weld") {
+      options.weld = true;
+    } else if (arg == "--bounds") {
+      options.print_bounds = true;
+    } else if (arg == "--recompute-normals") {
+      options.recompute_normals = true;
+    } else if (arg.starts_with("--generate=")) {
+      options.generated_shape = parse_generated_shape(arg.substr(arg.find('=') + 1));
+      if (!options.generated_shape) {
+        return std::nullopt;
+      }
+    } else if (arg.starts_with("--triangles=")) {
+      std::optional<size_t> count = parse_count(arg.substr(arg.find('=') + 1));
+      if (!count) {
+        return std::nullopt;
+      }
+      options.generated_triangles = *count;
+    } else if (arg == "--ascii") {
+      options.ascii = true;
+    } else if (arg == "--cache") {
+      options.use_cache = true;
+    } else if (arg.starts_with("--output=")) {
+      options.output_filepath = arg.substr(arg.find('=') + 1);
+      if (options.output_filepath.empty()) {
+        return std::nullopt;
+      }
+    } else if (arg.starts_with("--weld-epsilon=")) {
+      std::string_view value = arg.substr(arg.find('=') + 1);
+      auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), options.weld_epsilon);
+      if (ec != std::errc() || end != value.data() + value.size() || options.weld_epsilon < 0.0f) {
+        return std::nullopt;
+      }
+      options.weld = true;
+    } else if (arg == "--batch") {
+      options.batch = true;
+    } else if (arg.starts_with("--jobs=")) {
+      std::optional<size_t> count = parse_count(arg.substr(arg.find('=') + 1));
+      if (!count) {
+        return std::nullopt;
       }
-      ifs >> token; // expecting "endloop"
-      ifs >> token; // expecting "endfacet"
-      triangles.push_back(t);
+      options.batch_options.num_jobs = *count;
+    } else if (arg.starts_with("--manifest=")) {
+      options.batch_options.manifest_filepath = arg.substr(arg.find('=') + 1);
+      if (options.batch_options.manifest_filepath.empty()) {
+        return std::nullopt;
+      }
+    } else if (arg.starts_with("--")) {
+      return std::nullopt;
+    } else {
+      options.batch_options.inputs.emplace_back(arg);
     }
   }
-}
-
-static size_t calc_file_size(std::ifstream &ifs) {
-  auto original_pos = ifs.tellg();
-  ifs.seekg(0, std::ifstream::end);
-  auto end = ifs.tellg();
-  ifs.seekg(0, std::ifstream::beg);
-  size_t file_size = end - ifs.tellg();
-  ifs.seekg(original_pos, std::ifstream::beg);
-  return file_size;
-}
-
-static void read_stl(std::ifstream &ifs, std::vector<Triangle> &triangles) {
-  size_t file_size = calc_file_size(ifs);
-  if (file_size == 0) {
-    std::cout << "Empty file" << std::endl;
-    return;
-  }
-  ifs.seekg(BINARY_STL_HEADER_SIZE, std::ifstream::beg); // Seek right past the header
-
-  uint32_t num_triangles = 0;
-  ifs.read((char *)&num_triangles, sizeof(uint32_t));
-
-  if (file_size ==
-      (BINARY_STL_HEADER_SIZE + sizeof(uint32_t) + num_triangles * (sizeof(Triangle) + sizeof(uint16_t)))) {
-    read_binary_stl(num_triangles, ifs, triangles);
-  } else {
-    ifs.seekg(0, std::ifstream::beg);
-    read_ascii_stl(ifs, triangles);
+  if (options.batch) {
+    bool single_file_options = options.weld || options.print_bounds || options.recompute_normals ||
+                               options.generated_shape || options.ascii || !options.output_filepath.empty() ||
+                               options.use_cache;
+    bool has_inputs = !options.batch_options.inputs.empty() || !options.batch_options.manifest_filepath.empty();
+    return single_file_options || !has_inputs ? std::nullopt : std::optional(options);
   }
-}
-
-// https://en.cppreference.com/mwiki/index.php?title=cpp/string/basic_string/getline&oldid=152682#Notes
-static void skip_line(std::ifstream &ifs) { ifs.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); }
-
-static void parse_ply_property_definition_ascii(const PLY_Property_Definition &pd, std::ifstream &ifs,
-                                                String_Map<PLY_Property> &property_map) {
-  std::vector<double> &values = property_map[pd.name].values;
-  if (pd.type == PLY_Property_Definition::Type::List) {
-    size_t num_values;
-    ifs >> num_values;
-    for (size_t j = 0; j < num_values; j++) {
-      ifs >> values.emplace_back();
-    }
-  } else if (pd.type == PLY_Property_Definition::Type::Scalar) {
-    ifs >> values.emplace_back();
+  if (options.batch_options.inputs.size() != 1 || options.batch_options.num_jobs > 0 ||
+      !options.batch_options.manifest_filepath.empty()) {
+    return std::nullopt;
   }
+  options.filepath = options.batch_options.inputs[0];
+  return options;
 }
 
-static void parse_ply_element_definition_ascii(const PLY_Element_Definition &ed, std::ifstream &ifs,
-                                               Parsed_PLY &parsed_ply) {
-  std::vector<PLY_Element> &elements = parsed_ply.elements_map[ed.name];
-  for (size_t i = 0; i < ed.count; i++) {
-    PLY_Element &e = elements.emplace_back();
-    for (const PLY_Property_Definition &pd : ed.property_definitions) {
-      parse_ply_property_definition_ascii(pd, ifs, e.property_map);
-    }
+// A cache that cannot be written only costs the next run a parse, so failures are reported but not fatal
+static void store_mesh_cache(const std::string &filepath, const Mesh_Cache_Key &key, const Indexed_Mesh &mesh,
+                             std::span<const Vec3f> face_normals) {
+  try {
+    write_mesh_cache(mesh, face_normals, key, get_mesh_cache_path(filepath));
+  } catch (const std::exception &e) {
+    std::cerr << "Failed to write cache: " << e.what() << std::endl;
   }
 }
 
-static Parsed_PLY read_ply(std::ifstream &ifs) {
-  std::string token;
-  ifs >> token; // expecting "ply"
-  ifs >> token; // expecting "format"
-  ifs >> token; // expecting "ascii" or "binary_little_endian" or "binary_big_endian"
-  std::string format = token;
-  ifs >> token; // expecting "1.0" or version number
-
-  std::vector<PLY_Element_Definition> element_definitions;
-  while (ifs.good() && token != "end_header") {
-    ifs >> token;
-    if (token == "comment") {
-      skip_line(ifs);
-    } else if (token == "element") {
-      PLY_Element_Definition ed;
-      ifs >> ed.name;
-      ifs >> ed.count;
-      element_definitions.push_back(ed);
-    } else if (token == "property") {
-      PLY_Property_Definition pd{.type = PLY_Property_Definition::Type::Scalar};
-      ifs >> token;
-      if (token == "list") {
-        ifs >> token >> token; // Skip two tokens, list count type and list item type
-        pd.type = PLY_Property_Definition::Type::List;
-      }
-      ifs >> pd.name;
-      if (element_definitions.empty()) {
-        throw PLY_Expected_Element_Definition_Error();
-      }
-      element_definitions.back().property_definitions.push_back(pd);
-    }
+// Pipes cannot be mapped, so standard input is read into memory once and parsed from there
+static std::vector<std::byte> read_stdin() {
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+#endif
+  std::vector<std::byte> bytes;
+  size_t size = 0;
+  while (size == bytes.size()) {
+    bytes.resize(std::max(bytes.size() * 2, size_t{1} << 20));
+    size += std::fread(bytes.data() + size, 1, bytes.size() - size, stdin);
   }
-  Parsed_PLY parsed_ply;
-  if (format == "ascii") {
-    for (const PLY_Element_Definition &ed : element_definitions) {
-      parse_ply_element_definition_ascii(ed, ifs, parsed_ply);
-    }
+  if (std::ferror(stdin)) {
+    throw std::system_error(errno, std::generic_category(), "Failed to read standard input");
   }
-  return parsed_ply;
+  bytes.resize(size);
+  return bytes;
 }
 
-static void read_ply(std::ifstream &ifs, std::vector<Triangle> &triangles) {
-  Parsed_PLY parsed_ply = read_ply(ifs);
-  std::vector<Vec3f> vertices;
-  for (const PLY_Element &e : parsed_ply.elements_map.at("vertex")) {
-    // TODO: reduce key lookups by storing properties as a map to **vector of vectors**, instead of storing
-    // properties in a vector of elements as a map to **vector of scalars**
-    vertices.emplace_back(static_cast<float>(e.property_map.at("x").values[0]),
-                          static_cast<float>(e.property_map.at("y").values[0]),
-                          static_cast<float>(e.property_map.at("z").values[0]));
+int main(int argc, char **argv) {
+  std::optional<Options> options = parse_options(std::span(argv + 1, argc - 1));
+  if (!options) {
+    std::cerr << "Expected arguments: [--weld | --weld-epsilon=<distance>] [--bounds] [--recompute-normals] "
+                 "[--output=/path/to/output.<stl|ply> [--ascii]] [--cache] </path/to/mesh/file | ->"
+              << std::endl;
+    std::cerr << "                or: --generate=<sphere|torus|terrain> [--triangles=<count>] [--ascii] "
+                 "/path/to/output.<stl|ply>"
+              << std::endl;
+    std::cerr << "                or: --batch [--jobs=<count>] [--manifest=/path/to/list.txt] "
+                 "[</path/to/mesh/file | /path/to/directory | '/path/to/*.ply'>...]"
+              << std::endl;
+    return 1;
+  }
+  if (options->batch) {
+    return run_batch(options->batch_options);
   }
 
-  for (const PLY_Element &e : parsed_ply.elements_map.at("face")) {
-    auto vertex_indices_it = e.property_map.find("vertex_indices");
-    if (vertex_indices_it == e.property_map.end()) {
-      vertex_indices_it = e.property_map.find("vertex_index");
-    }
-    if (vertex_indices_it == e.property_map.end()) {
-      throw std::out_of_range(R"(Could not find face property "vertex_index" nor "vertex_indices" in PLY file)");
-    }
-    const std::vector<double> &vertex_indices = vertex_indices_it->second.values;
-    if (vertex_indices.size() != 3) {
-      throw std::domain_error(std::format("Expected face to have 3 vertices, but found {}", vertex_indices.size()));
+  const std::string &filepath = options->filepath;
+
+  if (options->generated_shape) {
+    // We convert to lower case so that comparing suffix later is case-insensitive
+    std::string lower_filepath = str_tolower(filepath);
+    Mesh_File_Format format;
+    if (lower_filepath.ends_with(".stl")) {
+      format = options->ascii ? Mesh_File_Format::ASCII_STL : Mesh_File_Format::Binary_STL;
+    } else if (lower_filepath.ends_with(".ply")) {
+      format = options->ascii ? Mesh_File_Format::ASCII_PLY : Mesh_File_Format::Binary_PLY;
+    } else {
+      std::cerr << "Unsupported format" << std::endl;
+      return 1;
     }
-    const Vec3f &v0 = vertices[static_cast<size_t>(vertex_indices[0])];
-    const Vec3f &v1 = vertices[static_cast<size_t>(vertex_indices[1])];
-    const Vec3f &v2 = vertices[static_cast<size_t>(vertex_indices[2])];
-    Vec3f normal = (v1 - v0).cross(v2 - v0);
-    normal.normalize();
-    triangles.push_back({normal, {v0, v1, v2}});
+    Parametric_Mesh mesh(*options->generated_shape, options->generated_triangles);
+    write_parametric_mesh(mesh, format, filepath);
+    std::cout << "Number of triangles: " << mesh.num_triangles() << std::endl;
+    std::cout << "Number of vertices: " << mesh.num_vertices() << std::endl;
+    return 0;
   }
-}
-
-// Based on: https://en.cppreference.com/mwiki/index.php?title=cpp/string/byte/tolower&oldid=152869#Notes
-static std::string str_tolower(std::string s) {
-  std::ranges::transform(s, s.begin(), [](unsigned char c) { return std::tolower(c); }); // Thanks SonarLint!
-  return s;
-}
 
-int main(int argc, char **argv) {
-  if (argc != 2) {
-    std::cerr << "Expected arguments: /path/to/mesh/file" << std::endl;
+  std::string lower_output_filepath = str_tolower(options->output_filepath);
+  bool output_stl = lower_output_filepath.ends_with(".stl");
+  bool output_ply = lower_output_filepath.ends_with(".ply") && !options->ascii; // Only binary PLY can be written
+  if (!lower_output_filepath.empty() && !output_stl && !output_ply) {
+    std::cerr << "Unsupported output format" << std::endl;
     return 1;
   }
 
-  std::string filepath = argv[1];
-
-  /* "What is the idiomatic C++17 standard approach to reading binary files?":
-   * https://stackoverflow.com/a/51353040/8094047
-   */
-
-  std::ifstream ifs;
-  ifs.exceptions(std::ifstream::badbit | std::ifstream::failbit); // Raise exceptions on failure
-
+  // "-" reads standard input
+  bool from_stdin = filepath == "-";
+  std::optional<Mapped_File> file;
+  std::vector<std::byte> stdin_bytes;
   try {
-    ifs.open(filepath, std::ifstream::binary);
-  } catch (const std::ifstream::failure &e) {
+    if (from_stdin) {
+      stdin_bytes = read_stdin();
+    } else {
+      file.emplace(filepath);
+    }
+  } catch (const std::system_error &e) {
     std::cerr << "Failed to open file: " << filepath << std::endl;
     std::cerr << e.what() << std::endl;
     return 1;
   }
+  std::span<const std::byte> bytes = from_stdin ? std::span<const std::byte>(stdin_bytes) : file->bytes();
 
-  // We convert to lower case so that comparing suffix later is case-insensitive
-  filepath = str_tolower(filepath);
+  // Loaders, decompression and writers report malformed input and I/O failures with exceptions
+  try {
+    // The cache is keyed on the source file size and modification time, a stale cache is rebuilt. Empty files have
+    // nothing worth caching, and standard input has no file to key on
+    Mesh_Cache_Key cache_key;
+    std::optional<Mapped_File> cache_file;
+    std::optional<Mesh_Cache_View> cache;
+    bool use_cache = options->use_cache && !from_stdin && !bytes.empty();
+    if (use_cache) {
+      cache_key = calc_mesh_cache_key(filepath);
+      try {
+        cache_file.emplace(get_mesh_cache_path(filepath).string());
+        cache = Mesh_Cache_View::from_bytes(cache_file->bytes(), cache_key);
+      } catch (const std::system_error &) {
+        // No cache yet
+      }
+    }
+    bool write_cache = use_cache && !cache;
+
+    size_t num_triangles = 0;
+    std::optional<size_t> num_vertices; // Only known for indexed meshes
+    Bounds bounds;
+    std::vector<Triangle> triangles; // Only filled when the whole triangle soup is needed
+    std::optional<Indexed_Mesh> mesh;
+    bool needs_triangle_soup = options->weld || !options->output_filepath.empty() || write_cache;
+
+    // Compressed input is decompressed on a background thread. Streamed STL is parsed chunk by chunk as it arrives, the
+    // other loaders need all of it first
+    std::optional<Decompressing_Reader> decompressor;
+    std::vector<std::byte> decompressed_bytes;
+    Input_Format format;
+    if (Compression compression = detect_compression(bytes); compression != Compression::None) {
+      decompressor.emplace(bytes, compression);
+      format = detect_streamed_input_format(decompressor->peek());
+      bool is_stl = format == Input_Format::Binary_STL || format == Input_Format::ASCII_STL;
+      if (!cache && (!is_stl || needs_triangle_soup)) {
+        decompressed_bytes = decompressor->read_all();
+        decompressor.reset();
+        bytes = decompressed_bytes;
+        format = detect_input_format(bytes); // Binary STL can be told exactly now that the size is known
+      }
+    } else {
+      format = detect_input_format(bytes);
+    }
 
-  std::vector<Triangle> triangles;
-  if (filepath.ends_with(".stl")) {
-    read_stl(ifs, triangles);
-  } else if (filepath.ends_with(".ply")) {
-    read_ply(ifs, triangles);
-  } else {
-    std::cerr << "Unsupported format" << std::endl;
-    return 1;
-  }
+    if (bytes.empty()) {
+      std::cout << "Empty file" << std::endl;
+    } else if (format == Input_Format::Binary_STL || format == Input_Format::ASCII_STL) {
+      if (needs_triangle_soup) {
+        if (cache) {
+          cache->append_triangle_soup(triangles);
+        } else {
+          read_stl(bytes, triangles);
+        }
+        if (write_cache) {
+          std::vector<Vec3f> face_normals(triangles.size());
+          std::ranges::transform(triangles, face_normals.begin(), [](const Triangle &t) { return t.normal; });
+          store_mesh_cache(filepath, cache_key, weld_vertices(triangles), face_normals);
+        }
+        if (options->recompute_normals) {
+          recompute_normals(triangles);
+        }
+        if (options->weld) {
+          mesh = weld_vertices(triangles, options->weld_epsilon);
+        }
+        num_triangles = triangles.size();
+        if (options->print_bounds && !mesh) {
+          bounds = calc_bounds(to_soa(triangles));
+        }
+      } else if (cache) {
+        // The cached vertices are exactly the distinct triangle corners, normals do not change the output
+        num_triangles = cache->num_triangles();
+        if (options->print_bounds) {
+          bounds = calc_bounds(to_soa(cache->vertices()));
+        }
+      } else {
+        // Nothing else needs the whole triangle soup, so it is processed one batch at a time
+        auto process_batch = [&](std::span<Triangle> batch) {
+          if (options->recompute_normals) {
+            recompute_normals(batch);
+          }
+          if (options->print_bounds) {
+            bounds.extend(calc_bounds(to_soa(batch)));
+          }
+          num_triangles += batch.size();
+        };
+        if (decompressor) {
+          read_stl(*decompressor, process_batch);
+        } else {
+          read_stl(bytes, process_batch);
+        }
+      }
+    } else if (format == Input_Format::PLY || format == Input_Format::OBJ || format == Input_Format::OFF) {
+      if (cache && output_ply) {
+        mesh = cache->to_indexed_mesh();
+      } else if (cache) {
+        // Counts and bounds are read from the mapped cache in place, only STL output needs a copy
+        num_triangles = cache->num_triangles();
+        num_vertices = cache->vertices().size();
+        if (options->print_bounds) {
+          bounds = calc_bounds(to_soa(cache->vertices()));
+        }
+        if (output_stl) {
+          cache->append_triangle_soup(triangles);
+        }
+      } else {
+        if (format == Input_Format::PLY) {
+          read_ply(bytes, mesh.emplace());
+        } else if (format == Input_Format::OBJ) {
+          read_obj(bytes, mesh.emplace());
+        } else {
+          read_off(bytes, mesh.emplace());
+        }
+        if (write_cache) {
+          store_mesh_cache(filepath, cache_key, *mesh, {});
+        }
+        if (output_stl) {
+          append_triangle_soup(*mesh, triangles);
+        }
+      }
+    } else {
+      std::cerr << "Unsupported format" << std::endl;
+      return 1;
+    }
+    if (mesh) {
+      num_triangles = mesh->num_triangles();
+      num_vertices = mesh->vertices.size();
+      if (options->print_bounds) {
+        bounds = calc_bounds(to_soa(mesh->vertices));
+      }
+    }
+
+    std::cout << "Number of triangles: " << num_triangles << std::endl;
+    if (num_vertices) {
+      std::cout << "Number of vertices: " << *num_vertices << std::endl;
+    }
+    if (options->print_bounds) {
+      std::cout << std::format("Bounds: ({}, {}, {}) - ({}, {}, {})", bounds.min.x, bounds.min.y, bounds.min.z,
+                               bounds.max.x, bounds.max.y, bounds.max.z)
+                << std::endl;
+    }
 
-  std::cout << "Number of triangles: " << triangles.size() << std::endl;
+    if (output_ply) {
+      if (!mesh) {
+        mesh = weld_vertices(triangles); // PLY output is indexed, corners at the same position share a vertex
+      }
+      write_binary_ply(*mesh, options->output_filepath);
+    } else if (output_stl && options->ascii) {
+      write_ascii_stl(triangles, options->output_filepath);
+    } else if (output_stl) {
+      write_binary_stl(triangles, options->output_filepath);
+    }
 
-  return 0;
+    return 0;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
 }
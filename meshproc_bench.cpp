@@ -0,0 +1,248 @@
+#include "cli_utils.hpp"
+
+#include <meshproc.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib> // std::malloc
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+using namespace meshproc;
+
+/* Benchmark harness for the meshproc_core loaders. Every loader is run a few times on every file and the
+ * fastest run is reported, so the numbers measure parsing of files already in the page cache rather than disk speed.
+ */
+
+#ifndef MESHPROC_SOURCE_DIR
+#define MESHPROC_SOURCE_DIR "."
+#endif
+
+/* Every allocation of the process goes through these replacements of the global operator new, so each benchmark can
+ * report how many allocations a load makes. The array and nothrow forms call these ones.
+ */
+static std::atomic<size_t> num_allocations = 0;
+static std::atomic<size_t> num_allocated_bytes = 0;
+
+void *operator new(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  num_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *p = std::malloc(size > 0 ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+// GCC flags free() in a replacement operator delete as mismatched with new, but the operator new above mallocs
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Over-aligned blocks are carved out of a larger malloc, with the malloc pointer stored right before the block
+void *operator new(size_t size, std::align_val_t alignment) {
+  auto align = static_cast<size_t>(alignment);
+  void *raw = operator new(size + align + sizeof(void *));
+  auto block = (reinterpret_cast<uintptr_t>(raw) + sizeof(void *) + align - 1) / align * align;
+  reinterpret_cast<void **>(block)[-1] = raw;
+  return reinterpret_cast<void *>(block);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+  if (p) {
+    std::free(static_cast<void **>(p)[-1]);
+  }
+}
+void operator delete(void *p, size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+
+template <typename F> static double time_seconds(F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Loader_Benchmark {
+  std::string_view name;
+  std::function<size_t(const std::string &filepath)> load; // Returns the number of triangles loaded
+};
+
+static std::vector<Loader_Benchmark> get_loader_benchmarks(const std::string &lower_filepath) {
+  if (lower_filepath.ends_with(".stl")) {
+    return {
+        {"read_stl (ifstream)",
+         [](const std::string &filepath) {
+           std::ifstream ifs(filepath, std::ifstream::binary); // No exceptions, the stream reader stops on EOF
+           std::vector<Triangle> triangles;
+           read_stl(ifs, triangles);
+           return triangles.size();
+         }},
+        {"read_stl (mapped)",
+         [](const std::string &filepath) {
+           Mapped_File file(filepath);
+           std::vector<Triangle> triangles;
+           read_stl(file.bytes(), triangles);
+           return triangles.size();
+         }},
+        {"read_stl (streamed)",
+         [](const std::string &filepath) {
+           Mapped_File file(filepath);
+           size_t num_triangles = 0;
+           read_stl(file.bytes(), [&](std::span<Triangle> batch) { num_triangles += batch.size(); });
+           return num_triangles;
+         }},
+        {"Binary_STL_View traversal",
+         [](const std::string &filepath) {
+           Mapped_File file(filepath);
+           auto view = Binary_STL_View::from_bytes(file.bytes());
+           if (!view) {
+             throw std::domain_error("not a binary STL file");
+           }
+           float checksum = 0; // Consumed below so the compiler cannot drop the traversal
+           for (const Triangle &t : view->triangles()) {
+             checksum += t.vertices[0].x;
+           }
+           return checksum == -1.0f ? 0 : view->size();
+         }},
+    };
+  }
+  if (lower_filepath.ends_with(".ply")) {
+    return {
+        {"read_ply (indexed)",
+         [](const std::string &filepath) {
+           Mapped_File file(filepath);
+           Indexed_Mesh mesh;
+           read_ply(file.bytes(), mesh);
+           return mesh.num_triangles();
+         }},
+        {"read_ply (soup)",
+         [](const std::string &filepath) {
+           Mapped_File file(filepath);
+           std::vector<Triangle> triangles;
+           read_ply(file.bytes(), triangles);
+           return triangles.size();
+         }},
+        {"read_ply (streamed)",
+         [](const std::string &filepath) {
+           Mapped_File file(filepath);
+           size_t num_triangles = 0;
+           read_ply(file.bytes(), [&](std::span<Triangle> batch) { num_triangles += batch.size(); });
+           return num_triangles;
+         }},
+    };
+  }
+  if (lower_filepath.ends_with(".obj")) {
+    return {
+        {"read_obj (indexed)",
+         [](const std::string &filepath) {
+           Mapped_File file(filepath);
+           Indexed_Mesh mesh;
+           read_obj(file.bytes(), mesh);
+           return mesh.num_triangles();
+         }},
+    };
+  }
+  if (lower_filepath.ends_with(".off")) {
+    return {
+        {"read_off (indexed)",
+         [](const std::string &filepath) {
+           Mapped_File file(filepath);
+           Indexed_Mesh mesh;
+           read_off(file.bytes(), mesh);
+           return mesh.num_triangles();
+         }},
+    };
+  }
+  return {};
+}
+
+static void run_loader_benchmarks(const std::filesystem::path &filepath, size_t num_repeats) {
+  size_t file_size = std::filesystem::file_size(filepath);
+  for (const Loader_Benchmark &benchmark : get_loader_benchmarks(str_tolower(filepath.string()))) {
+    std::string label = std::format("{:<28} {:<26}", filepath.filename().string(), benchmark.name);
+    try {
+      double best_seconds = std::numeric_limits<double>::infinity();
+      size_t num_triangles = 0;
+      size_t run_allocations = 0; // Of the last run, loads allocate the same way every time
+      size_t run_allocated_bytes = 0;
+      for (size_t i = 0; i < num_repeats; i++) {
+        size_t allocations_before = num_allocations;
+        size_t allocated_bytes_before = num_allocated_bytes;
+        best_seconds = std::min(best_seconds, time_seconds([&] { num_triangles = benchmark.load(filepath.string()); }));
+        run_allocations = num_allocations - allocations_before;
+        run_allocated_bytes = num_allocated_bytes - allocated_bytes_before;
+      }
+      std::cout << std::format("{} {:>10.2f} MB {:>10} tris {:>9.4f} s {:>10.1f} MB/s {:>14.0f} tris/s {:>9} allocs "
+                               "{:>10.2f} MB allocated\n",
+                               label, file_size / 1e6, num_triangles, best_seconds, file_size / best_seconds / 1e6,
+                               num_triangles / best_seconds, run_allocations, run_allocated_bytes / 1e6);
+    } catch (const std::exception &e) {
+      std::cout << std::format("{} skipped: {}\n", label, e.what());
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t num_triangles = 2'000'000;
+  size_t num_repeats = 3;
+  std::vector<std::filesystem::path> filepaths;
+  for (std::string_view arg : std::span(argv + 1, argc - 1)) {
+    std::optional<size_t> count;
+    if (arg.starts_with("--triangles=") && (count = parse_count(arg.substr(arg.find('=') + 1)))) {
+      num_triangles = *count;
+    } else if (arg.starts_with("--repeat=") && (count = parse_count(arg.substr(arg.find('=') + 1))) && *count > 0) {
+      num_repeats = *count;
+    } else if (arg.starts_with("--")) {
+      std::cerr << "Expected arguments: [--triangles=<count>] [--repeat=<count>] [/path/to/mesh/file...]" << std::endl;
+      std::cerr << "Without files, the bundled meshes are used. --triangles=0 skips generated meshes." << std::endl;
+      return 1;
+    } else {
+      filepaths.emplace_back(arg);
+    }
+  }
+  if (filepaths.empty()) {
+    for (const char *name : {"Stanford_Bunny.stl", "Sphericon.stl", "bun_zipper.ply", "bun_zipper_res4.ply"}) {
+      filepaths.push_back(std::filesystem::path(MESHPROC_SOURCE_DIR) / name);
+    }
+  }
+
+  std::vector<std::filesystem::path> generated_filepaths;
+  if (num_triangles > 0) {
+    auto directory = std::filesystem::temp_directory_path();
+    std::cout << std::format("Generating meshes of about {} triangles in {}\n", num_triangles, directory.string());
+    Parametric_Mesh mesh(Generated_Shape::Terrain, num_triangles);
+    generated_filepaths = {directory / "meshproc_bench_binary.stl", directory / "meshproc_bench_ascii.stl",
+                           directory / "meshproc_bench_ascii.ply", directory / "meshproc_bench_binary.ply"};
+    write_parametric_mesh(mesh, Mesh_File_Format::Binary_STL, generated_filepaths[0]);
+    write_parametric_mesh(mesh, Mesh_File_Format::ASCII_STL, generated_filepaths[1]);
+    write_parametric_mesh(mesh, Mesh_File_Format::ASCII_PLY, generated_filepaths[2]);
+    write_parametric_mesh(mesh, Mesh_File_Format::Binary_PLY, generated_filepaths[3]);
+  }
+
+  std::cout << std::format("Using {} threads, best of {} runs\n", std::max(1u, std::thread::hardware_concurrency()),
+                           num_repeats);
+  for (const std::filesystem::path &filepath : filepaths) {
+    if (!std::filesystem::exists(filepath)) {
+      std::cout << std::format("{} skipped: file not found\n", filepath.string());
+      continue;
+    }
+    run_loader_benchmarks(filepath, num_repeats);
+  }
+  for (const std::filesystem::path &filepath : generated_filepaths) {
+    run_loader_benchmarks(filepath, num_repeats);
+    std::filesystem::remove(filepath);
+  }
+  return 0;
+}
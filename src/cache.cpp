@@ -0,0 +1,211 @@
+#include "internal.hpp"
+
+#include <memory> // std::make_unique
+#include <random>
+#include <system_error>
+
+namespace meshproc {
+
+constexpr std::array<char, 8> MESH_CACHE_MAGIC = {'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H'};
+// Written in native byte order, reads back differently on a host of the other byte order
+constexpr uint32_t MESH_CACHE_BYTE_ORDER_MARK = 0x01020304;
+constexpr size_t MESH_CACHE_CHECKSUM_BLOCK_SIZE = 1 << 20;
+
+struct Mesh_Cache_Header {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t byte_order_mark;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t file_size;
+  uint64_t num_vertices;
+  uint64_t num_indices;
+  uint64_t num_face_normals;
+  uint64_t vertices_offset;
+  uint64_t indices_offset;
+  uint64_t face_normals_offset;
+  uint64_t checksum; // Of everything after the header, padding included
+};
+
+static constexpr size_t align_mesh_cache_offset(size_t offset) {
+  return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+}
+
+// Sections start right after the header, so this is also where the checksummed bytes start
+constexpr size_t MESH_CACHE_SECTIONS_OFFSET = align_mesh_cache_offset(sizeof(Mesh_Cache_Header));
+
+struct Mesh_Cache_Scan {
+  uint64_t checksum;
+  uint32_t max_index; // Of `indices`, 0 when empty
+};
+
+/* Blocks are hashed in parallel, 8 bytes at a time, then the block hashes are combined in order. This only guards
+ * against truncated or corrupted files, not against deliberate tampering. `indices` must lie inside `bytes`, each block
+ * also scans the indices it covers so they are validated without a second pass over the file.
+ */
+static Mesh_Cache_Scan scan_mesh_cache(std::span<const std::byte> bytes, std::span<const uint32_t> indices) {
+  size_t num_blocks = (bytes.size() + MESH_CACHE_CHECKSUM_BLOCK_SIZE - 1) / MESH_CACHE_CHECKSUM_BLOCK_SIZE;
+  size_t indices_offset = indices.empty() ? 0 : reinterpret_cast<const std::byte *>(indices.data()) - bytes.data();
+  std::vector<uint64_t> block_hashes(num_blocks);
+  std::vector<uint32_t> block_max_indices(num_blocks);
+  parallel_for(num_blocks, 16, [&](size_t begin, size_t end, size_t) {
+    for (size_t block = begin; block < end; block++) {
+      std::span<const std::byte> block_bytes = bytes.subspan(
+          block * MESH_CACHE_CHECKSUM_BLOCK_SIZE,
+          std::min(MESH_CACHE_CHECKSUM_BLOCK_SIZE, bytes.size() - block * MESH_CACHE_CHECKSUM_BLOCK_SIZE));
+      uint64_t hash = block;
+      size_t i = 0;
+      for (; i + sizeof(uint64_t) <= block_bytes.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, block_bytes.data() + i, sizeof(uint64_t));
+        hash = std::rotl((hash ^ word) * 0x9E3779B97F4A7C15ull, 31);
+      }
+      for (; i < block_bytes.size(); i++) {
+        hash = std::rotl((hash ^ static_cast<uint64_t>(block_bytes[i])) * 0x9E3779B97F4A7C15ull, 31);
+      }
+      block_hashes[block] = mix_bits(hash);
+
+      // Indices are 4-byte aligned and blocks a multiple of 4 bytes, so each index is in exactly one block
+      size_t block_begin = block * MESH_CACHE_CHECKSUM_BLOCK_SIZE;
+      size_t block_end = block_begin + block_bytes.size();
+      size_t first_index = (std::clamp(block_begin, indices_offset, indices_offset + indices.size_bytes()) -
+                            indices_offset) / sizeof(uint32_t);
+      size_t last_index = (std::clamp(block_end, indices_offset, indices_offset + indices.size_bytes()) -
+                           indices_offset) / sizeof(uint32_t);
+      uint32_t max_index = 0;
+      for (size_t j = first_index; j < last_index; j++) {
+        max_index = std::max(max_index, indices[j]);
+      }
+      block_max_indices[block] = max_index;
+    }
+  });
+  Mesh_Cache_Scan scan = {.checksum = mix_bits(bytes.size()), .max_index = 0};
+  for (size_t block = 0; block < num_blocks; block++) {
+    scan.checksum = mix_bits(scan.checksum ^ block_hashes[block]);
+    scan.max_index = std::max(scan.max_index, block_max_indices[block]);
+  }
+  return scan;
+}
+
+Mesh_Cache_Key calc_mesh_cache_key(const std::filesystem::path &source_filepath) {
+  auto mtime = std::filesystem::last_write_time(source_filepath).time_since_epoch().count();
+  return {.source_size = std::filesystem::file_size(source_filepath), .source_mtime = static_cast<int64_t>(mtime)};
+}
+
+std::filesystem::path get_mesh_cache_path(const std::filesystem::path &source_filepath) {
+  std::filesystem::path cache_filepath = source_filepath;
+  cache_filepath += ".meshcache";
+  return cache_filepath;
+}
+
+void write_mesh_cache(const Indexed_Mesh &mesh, std::span<const Vec3f> face_normals, const Mesh_Cache_Key &key,
+                      const std::filesystem::path &filepath) {
+  if (!face_normals.empty() && face_normals.size() != mesh.num_triangles()) {
+    throw std::invalid_argument(
+        std::format("Expected {} face normals but got {}", mesh.num_triangles(), face_normals.size()));
+  }
+  Mesh_Cache_Header header{
+      .magic = MESH_CACHE_MAGIC,
+      .version = MESH_CACHE_VERSION,
+      .byte_order_mark = MESH_CACHE_BYTE_ORDER_MARK,
+      .source_size = key.source_size,
+      .source_mtime = key.source_mtime,
+      .num_vertices = mesh.vertices.size(),
+      .num_indices = mesh.indices.size(),
+      .num_face_normals = face_normals.size(),
+  };
+  header.vertices_offset = MESH_CACHE_SECTIONS_OFFSET;
+  header.indices_offset = align_mesh_cache_offset(header.vertices_offset + mesh.vertices.size() * sizeof(Vec3f));
+  header.face_normals_offset = align_mesh_cache_offset(header.indices_offset + mesh.indices.size() * sizeof(uint32_t));
+  header.file_size = header.face_normals_offset + face_normals.size() * sizeof(Vec3f);
+
+  // Assembled in memory so the padding is zeroed and the checksum computed in one parallel pass
+  auto buffer = std::make_unique<std::byte[]>(header.file_size);
+  auto store_section = [&](uint64_t offset, std::span<const std::byte> section) {
+    std::ranges::copy(section, buffer.get() + offset);
+  };
+  store_section(header.vertices_offset, std::as_bytes(std::span(mesh.vertices)));
+  store_section(header.indices_offset, std::as_bytes(std::span(mesh.indices)));
+  store_section(header.face_normals_offset, std::as_bytes(face_normals));
+  header.checksum =
+      scan_mesh_cache(std::span(buffer.get(), header.file_size).subspan(MESH_CACHE_SECTIONS_OFFSET), {}).checksum;
+  std::memcpy(buffer.get(), &header, sizeof(header));
+
+  // A random suffix keeps concurrent writers of the same cache from writing into each other's temporary file
+  std::filesystem::path temporary_filepath = filepath;
+  temporary_filepath += std::format(".{:x}.tmp", std::random_device{}());
+  try {
+    std::ofstream ofs;
+    ofs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+    ofs.open(temporary_filepath, std::ofstream::binary);
+    ofs.write(reinterpret_cast<const char *>(buffer.get()), static_cast<std::streamsize>(header.file_size));
+    ofs.close();
+    std::filesystem::rename(temporary_filepath, filepath);
+  } catch (...) {
+    std::error_code ignored;
+    std::filesystem::remove(temporary_filepath, ignored);
+    throw;
+  }
+}
+
+std::optional<Mesh_Cache_View> Mesh_Cache_View::from_bytes(std::span<const std::byte> bytes,
+                                                           const Mesh_Cache_Key &key) {
+  if (bytes.size() < MESH_CACHE_SECTIONS_OFFSET) {
+    return std::nullopt;
+  }
+  Mesh_Cache_Header header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION ||
+      header.byte_order_mark != MESH_CACHE_BYTE_ORDER_MARK || header.file_size != bytes.size() ||
+      Mesh_Cache_Key{header.source_size, header.source_mtime} != key) {
+    return std::nullopt;
+  }
+  // Sections must be aligned, in order and inside the file; counts are bounded first so sizes cannot overflow
+  auto section_fits = [&](uint64_t offset, uint64_t count, size_t item_size, uint64_t section_end) {
+    return offset % MESH_CACHE_ALIGNMENT == 0 && offset <= section_end && count <= bytes.size() / item_size &&
+           count * item_size <= section_end - offset;
+  };
+  if (header.vertices_offset != MESH_CACHE_SECTIONS_OFFSET ||
+      !section_fits(header.vertices_offset, header.num_vertices, sizeof(Vec3f), header.indices_offset) ||
+      !section_fits(header.indices_offset, header.num_indices, sizeof(uint32_t), header.face_normals_offset) ||
+      !section_fits(header.face_normals_offset, header.num_face_normals, sizeof(Vec3f), header.file_size) ||
+      header.num_indices % 3 != 0 ||
+      (header.num_face_normals != 0 && header.num_face_normals != header.num_indices / 3)) {
+    return std::nullopt;
+  }
+  // Mappings start on a page boundary and sections are aligned within the file, so the arrays can be used in place
+  std::span<const uint32_t> indices(reinterpret_cast<const uint32_t *>(bytes.data() + header.indices_offset),
+                                    header.num_indices);
+  Mesh_Cache_Scan scan = scan_mesh_cache(bytes.subspan(MESH_CACHE_SECTIONS_OFFSET), indices);
+  if (scan.checksum != header.checksum || (!indices.empty() && scan.max_index >= header.num_vertices)) {
+    return std::nullopt;
+  }
+  return Mesh_Cache_View(
+      {reinterpret_cast<const Vec3f *>(bytes.data() + header.vertices_offset), header.num_vertices}, indices,
+      {reinterpret_cast<const Vec3f *>(bytes.data() + header.face_normals_offset), header.num_face_normals});
+}
+
+Indexed_Mesh Mesh_Cache_View::to_indexed_mesh() const {
+  return {{vertices_.begin(), vertices_.end()}, {indices_.begin(), indices_.end()}};
+}
+
+void Mesh_Cache_View::append_triangle_soup(std::vector<Triangle> &triangles) const {
+  size_t first_triangle = triangles.size();
+  triangles.resize(first_triangle + num_triangles());
+  parallel_for(num_triangles(), SOA_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    for (size_t i = begin; i < end; i++) {
+      Triangle &t = triangles[first_triangle + i];
+      for (size_t j = 0; j < 3; j++) {
+        t.vertices[j] = vertices_[indices_[i * 3 + j]];
+      }
+      if (!face_normals_.empty()) {
+        t.normal = face_normals_[i];
+      }
+    }
+  });
+  if (face_normals_.empty()) {
+    recompute_normals(std::span(triangles).subspan(first_triangle));
+  }
+}
+
+} // namespace meshproc
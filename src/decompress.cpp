@@ -0,0 +1,244 @@
+#include "internal.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#ifdef MESHPROC_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef MESHPROC_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace meshproc {
+
+Compression detect_compression(std::span<const std::byte> bytes) {
+  if (Binary_STL_View::from_bytes(bytes)) {
+    return Compression::None;
+  }
+  std::string_view text = as_text(bytes);
+  if (text.starts_with("\x1F\x8B\x08")) { // Magic then the compression method, 8 (deflate) is the only one defined
+    return Compression::Gzip;
+  }
+  if (text.starts_with("\x28\xB5\x2F\xFD")) {
+    return Compression::Zstd;
+  }
+  return Compression::None;
+}
+
+// Chunks handed over from the decompressor thread to the reader
+struct Chunk_Queue {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::vector<std::byte>> chunks;       // Decompressed, not consumed yet
+  std::vector<std::vector<std::byte>> free_chunks; // Consumed, their memory is reused
+  bool done = false;
+  bool stopped = false; // Set by the reader when it is destroyed before the end of the data
+  std::exception_ptr error;
+
+  // Called by the decompressor for an empty chunk of DECOMPRESSION_CHUNK_SIZE bytes
+  std::vector<std::byte> take_free_chunk() {
+    std::vector<std::byte> chunk;
+    {
+      std::lock_guard lock(mutex);
+      if (!free_chunks.empty()) {
+        chunk = std::move(free_chunks.back());
+        free_chunks.pop_back();
+      }
+    }
+    chunk.resize(Decompressing_Reader::DECOMPRESSION_CHUNK_SIZE);
+    return chunk;
+  }
+
+  /* Called by the decompressor with the first `size` bytes of `chunk` filled, which it replaces with an empty chunk.
+   * Waits while the queue is full, returns false when the reader is gone and decompression should stop.
+   */
+  bool push_chunk(std::vector<std::byte> &chunk, size_t size) {
+    chunk.resize(size);
+    {
+      std::unique_lock lock(mutex);
+      changed.wait(lock, [&] { return chunks.size() < Decompressing_Reader::DECOMPRESSION_QUEUE_SIZE || stopped; });
+      if (stopped) {
+        return false;
+      }
+      chunks.push_back(std::move(chunk));
+    }
+    changed.notify_all();
+    chunk = take_free_chunk();
+    return true;
+  }
+
+  // Waits for a chunk or the end of the data, rethrows the decompression error once all the good chunks are consumed
+  void wait_for_chunk(std::unique_lock<std::mutex> &lock) {
+    changed.wait(lock, [&] { return !chunks.empty() || done; });
+    if (chunks.empty() && error) {
+      std::rethrow_exception(error);
+    }
+  }
+};
+
+struct Decompressing_Reader::State : Chunk_Queue {
+  std::thread thread;
+};
+
+#ifdef MESHPROC_HAS_ZLIB
+static void inflate_gzip(std::span<const std::byte> bytes, Chunk_Queue &queue) {
+  z_stream stream{};
+  // 16 expects a gzip header and trailer instead of the zlib ones
+  if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+    throw std::bad_alloc();
+  }
+  struct Stream_Guard {
+    z_stream &stream;
+    ~Stream_Guard() { inflateEnd(&stream); }
+  } guard{stream};
+
+  std::vector<std::byte> chunk = queue.take_free_chunk();
+  size_t chunk_size = 0;
+  size_t input_pos = 0;
+  while (true) {
+    if (stream.avail_in == 0 && input_pos < bytes.size()) {
+      // avail_in is 32 bits, larger inputs are fed a piece at a time
+      size_t input_size = std::min(bytes.size() - input_pos, size_t{1} << 30);
+      stream.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(bytes.data() + input_pos));
+      stream.avail_in = static_cast<uInt>(input_size);
+      input_pos += input_size;
+    }
+    stream.next_out = reinterpret_cast<Bytef *>(chunk.data() + chunk_size);
+    stream.avail_out = static_cast<uInt>(chunk.size() - chunk_size);
+    int result = inflate(&stream, Z_NO_FLUSH);
+    chunk_size = chunk.size() - stream.avail_out;
+    if (result == Z_STREAM_END) {
+      if (stream.avail_in == 0 && input_pos == bytes.size()) {
+        break;
+      }
+      // Concatenated gzip members decompress to the concatenation of their data
+      inflateReset(&stream);
+    } else if (result == Z_BUF_ERROR && stream.avail_in == 0 && input_pos == bytes.size()) {
+      throw std::domain_error("Unexpected end of gzip data");
+    } else if (result != Z_OK && result != Z_BUF_ERROR) {
+      throw std::domain_error(std::format("Invalid gzip data: {}", stream.msg ? stream.msg : "unknown error"));
+    }
+    if (chunk_size == chunk.size()) {
+      if (!queue.push_chunk(chunk, chunk_size)) {
+        return;
+      }
+      chunk_size = 0;
+    }
+  }
+  if (chunk_size > 0) {
+    queue.push_chunk(chunk, chunk_size);
+  }
+}
+#endif
+
+#ifdef MESHPROC_HAS_ZSTD
+static void decompress_zstd(std::span<const std::byte> bytes, Chunk_Queue &queue) {
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+  if (!context) {
+    throw std::bad_alloc();
+  }
+  std::vector<std::byte> chunk = queue.take_free_chunk();
+  ZSTD_inBuffer input{bytes.data(), bytes.size(), 0};
+  ZSTD_outBuffer output{chunk.data(), chunk.size(), 0};
+  size_t result = 0;
+  // Output may still be pending in the context once all the input is consumed, until a call leaves room in the chunk
+  bool output_full = false;
+  while (input.pos < input.size || output_full) {
+    result = ZSTD_decompressStream(context.get(), &output, &input);
+    if (ZSTD_isError(result)) {
+      throw std::domain_error(std::format("Invalid zstd data: {}", ZSTD_getErrorName(result)));
+    }
+    output_full = output.pos == output.size;
+    if (output_full) {
+      if (!queue.push_chunk(chunk, output.pos)) {
+        return;
+      }
+      output = {chunk.data(), chunk.size(), 0};
+    }
+  }
+  if (result != 0) { // Not at the end of a frame
+    throw std::domain_error("Unexpected end of zstd data");
+  }
+  if (output.pos > 0) {
+    queue.push_chunk(chunk, output.pos);
+  }
+}
+#endif
+
+Decompressing_Reader::Decompressing_Reader(std::span<const std::byte> bytes, Compression compression)
+    : state_(std::make_unique<State>()) {
+  void (*decompress)(std::span<const std::byte>, Chunk_Queue &) = nullptr;
+  if (compression == Compression::Gzip) {
+#ifdef MESHPROC_HAS_ZLIB
+    decompress = inflate_gzip;
+#else
+    throw std::domain_error("gzip input is not supported, meshproc was built without zlib");
+#endif
+  } else if (compression == Compression::Zstd) {
+#ifdef MESHPROC_HAS_ZSTD
+    decompress = decompress_zstd;
+#else
+    throw std::domain_error("zstd input is not supported, meshproc was built without libzstd");
+#endif
+  } else {
+    throw std::invalid_argument("Expected compressed data");
+  }
+  state_->thread = std::thread([bytes, decompress, &queue = static_cast<Chunk_Queue &>(*state_)] {
+    try {
+      decompress(bytes, queue);
+    } catch (...) {
+      queue.error = std::current_exception();
+    }
+    {
+      std::lock_guard lock(queue.mutex);
+      queue.done = true;
+    }
+    queue.changed.notify_all();
+  });
+}
+
+Decompressing_Reader::~Decompressing_Reader() {
+  {
+    std::lock_guard lock(state_->mutex);
+    state_->stopped = true;
+  }
+  state_->changed.notify_all();
+  state_->thread.join();
+}
+
+std::span<const std::byte> Decompressing_Reader::peek() {
+  std::unique_lock lock(state_->mutex);
+  state_->wait_for_chunk(lock);
+  // Only the decompressor adds chunks, at the back, so the front one stays put until next_chunk()
+  return state_->chunks.empty() ? std::span<const std::byte>() : std::span<const std::byte>(state_->chunks.front());
+}
+
+bool Decompressing_Reader::next_chunk(std::vector<std::byte> &chunk) {
+  {
+    std::unique_lock lock(state_->mutex);
+    state_->wait_for_chunk(lock);
+    if (state_->chunks.empty()) {
+      return false;
+    }
+    std::swap(chunk, state_->chunks.front());
+    if (state_->chunks.front().capacity() > 0) {
+      state_->free_chunks.push_back(std::move(state_->chunks.front()));
+    }
+    state_->chunks.pop_front();
+  }
+  state_->changed.notify_all();
+  return true;
+}
+
+std::vector<std::byte> Decompressing_Reader::read_all() {
+  std::vector<std::byte> bytes;
+  std::vector<std::byte> chunk;
+  while (next_chunk(chunk)) {
+    bytes.insert(bytes.end(), chunk.begin(), chunk.end());
+  }
+  return bytes;
+}
+
+} // namespace meshproc
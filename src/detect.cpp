@@ -0,0 +1,69 @@
+#include "internal.hpp"
+
+namespace meshproc {
+
+// OFF headers are "OFF" with optional prefixes: ST (texture coordinates), C (colors), N (normals), 4 (homogeneous
+// coordinates) and n (dimension)
+static bool is_off_keyword(std::string_view keyword) {
+  return keyword.ends_with("OFF") &&
+         keyword.substr(0, keyword.size() - 3).find_first_not_of("STCN4n") == std::string_view::npos;
+}
+
+static bool is_obj_keyword(std::string_view keyword) {
+  constexpr std::array<std::string_view, 11> keywords = {"v", "vt", "vn", "vp", "f", "l", "o", "g", "s", "mtllib",
+                                                         "usemtl"};
+  return std::ranges::find(keywords, keyword) != keywords.end();
+}
+
+// Text signatures, once binary STL and PLY are ruled out
+static Input_Format detect_text_format(std::string_view text) {
+  if (text.starts_with("\xEF\xBB\xBF")) { // UTF-8 byte order mark, written by some Windows tools
+    text.remove_prefix(3);
+  }
+  Text_Cursor cursor(text);
+  for (std::string_view keyword = cursor.next_token(); !keyword.empty(); keyword = cursor.next_token()) {
+    if (keyword.starts_with('#')) {
+      cursor.skip_line();
+      continue;
+    }
+    if (keyword == "solid") {
+      return Input_Format::ASCII_STL;
+    }
+    if (is_off_keyword(keyword)) {
+      return Input_Format::OFF;
+    }
+    if (is_obj_keyword(keyword)) {
+      return Input_Format::OBJ;
+    }
+    break;
+  }
+  return Input_Format::Unknown;
+}
+
+static bool is_ply_magic(std::string_view text) {
+  return text.starts_with("ply") && text.size() > 3 && (text[3] == '\n' || text[3] == '\r');
+}
+
+Input_Format detect_input_format(std::span<const std::byte> bytes) {
+  if (Binary_STL_View::from_bytes(bytes)) {
+    return Input_Format::Binary_STL;
+  }
+  std::string_view text = as_text(bytes.first(std::min(bytes.size(), INPUT_FORMAT_SNIFF_SIZE)));
+  return is_ply_magic(text) ? Input_Format::PLY : detect_text_format(text);
+}
+
+Input_Format detect_streamed_input_format(std::span<const std::byte> prefix) {
+  std::string_view text = as_text(prefix.first(std::min(prefix.size(), INPUT_FORMAT_SNIFF_SIZE)));
+  if (is_ply_magic(text)) {
+    return Input_Format::PLY;
+  }
+  // Control characters other than whitespace do not appear in text, but the floats and counts of binary STL records
+  // are full of them
+  auto is_control = [](char c) { return static_cast<unsigned char>(c) < 0x20 && !is_space(c); };
+  if (std::ranges::any_of(text, is_control)) {
+    return text.size() >= BINARY_STL_HEADER_SIZE + sizeof(uint32_t) ? Input_Format::Binary_STL : Input_Format::Unknown;
+  }
+  return detect_text_format(text);
+}
+
+} // namespace meshproc
@@ -0,0 +1,181 @@
+#include "internal.hpp"
+
+#include <numbers> // std::numbers::pi_v
+
+namespace meshproc {
+
+std::optional<Generated_Shape> parse_generated_shape(std::string_view name) {
+  if (name == "sphere") {
+    return Generated_Shape::Sphere;
+  }
+  if (name == "torus") {
+    return Generated_Shape::Torus;
+  }
+  if (name == "terrain") {
+    return Generated_Shape::Terrain;
+  }
+  return std::nullopt;
+}
+
+// Smooth noise in [-1, 1] interpolated between pseudo-random values at integer coordinates
+static float calc_value_noise(float x, float y) {
+  auto lattice_value = [](int64_t ix, int64_t iy) {
+    uint64_t h = mix_bits(static_cast<uint64_t>(ix) ^ mix_bits(static_cast<uint64_t>(iy)));
+    return static_cast<float>(h >> 40) / static_cast<float>(1 << 24) * 2.0f - 1.0f;
+  };
+  auto smoothstep = [](float t) { return t * t * (3.0f - 2.0f * t); };
+  float fx = std::floor(x);
+  float fy = std::floor(y);
+  auto ix = static_cast<int64_t>(fx);
+  auto iy = static_cast<int64_t>(fy);
+  float tx = smoothstep(x - fx);
+  float ty = smoothstep(y - fy);
+  float bottom = std::lerp(lattice_value(ix, iy), lattice_value(ix + 1, iy), tx);
+  float top = std::lerp(lattice_value(ix, iy + 1), lattice_value(ix + 1, iy + 1), tx);
+  return std::lerp(bottom, top, ty);
+}
+
+Parametric_Mesh::Parametric_Mesh(Generated_Shape shape, size_t num_triangles) : shape_(shape) {
+  // Triangles per unit of resolution squared: 6 grids of n * n quads, n * 2n quads, n * n quads
+  double triangles_per_cell = shape == Generated_Shape::Sphere ? 12.0 : shape == Generated_Shape::Torus ? 4.0 : 2.0;
+  resolution_ = std::max(size_t{2}, static_cast<size_t>(std::lround(std::sqrt(num_triangles / triangles_per_cell))));
+  if (this->num_vertices() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error(std::format("Cannot index {} vertices with 32 bits indices", this->num_vertices()));
+  }
+}
+
+Vec3f Parametric_Mesh::vertex(size_t i) const {
+  size_t grid = i / (vertex_rows() * vertex_columns());
+  size_t row = i / vertex_columns() % vertex_rows();
+  size_t column = i % vertex_columns();
+  float s = static_cast<float>(column) / static_cast<float>(columns()); // In [0, 1]
+  float t = static_cast<float>(row) / static_cast<float>(rows());
+  switch (shape_) {
+  case Generated_Shape::Sphere: {
+    // Cube face axes, with u cross v pointing outwards so triangles wind counter-clockwise seen from outside
+    static constexpr std::array<std::array<Vec3f, 3>, 6> faces{{
+        {{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}},
+        {{{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}}},
+        {{{0, 1, 0}, {0, 0, 1}, {1, 0, 0}}},
+        {{{0, -1, 0}, {1, 0, 0}, {0, 0, 1}}},
+        {{{0, 0, 1}, {1, 0, 0}, {0, 1, 0}}},
+        {{{0, 0, -1}, {0, 1, 0}, {1, 0, 0}}},
+    }};
+    const auto &[normal, u, v] = faces[grid];
+    // tan() spreads vertices more evenly over the sphere than a plain projection of the cube grid
+    constexpr float quarter_pi = std::numbers::pi_v<float> / 4.0f;
+    Vec3f p = normal + u * std::tan((s * 2.0f - 1.0f) * quarter_pi) + v * std::tan((t * 2.0f - 1.0f) * quarter_pi);
+    p.normalize();
+    return p;
+  }
+  case Generated_Shape::Torus: {
+    constexpr float major_radius = 1.0f;
+    constexpr float minor_radius = 0.35f;
+    float theta = s * 2.0f * std::numbers::pi_v<float>;
+    float phi = t * 2.0f * std::numbers::pi_v<float>;
+    float ring = major_radius + minor_radius * std::cos(phi);
+    return {ring * std::cos(theta), ring * std::sin(theta), minor_radius * std::sin(phi)};
+  }
+  case Generated_Shape::Terrain: {
+    float x = s * 2.0f - 1.0f;
+    float y = t * 2.0f - 1.0f;
+    float height = 0.0f;
+    float amplitude = 0.25f;
+    float frequency = 4.0f;
+    for (int octave = 0; octave < 5; octave++) {
+      height += amplitude * calc_value_noise(x * frequency, y * frequency);
+      amplitude *= 0.5f;
+      frequency *= 2.0f;
+    }
+    return {x, y, height};
+  }
+  }
+  return {};
+}
+
+std::array<uint32_t, 3> Parametric_Mesh::triangle(size_t i) const {
+  size_t quad = i / 2;
+  size_t grid = quad / (rows() * columns());
+  size_t row = quad / columns() % rows();
+  size_t column = quad % columns();
+  auto vertex_index = [&](size_t r, size_t c) {
+    size_t grid_row = grid * vertex_rows() + r % vertex_rows();
+    return static_cast<uint32_t>(grid_row * vertex_columns() + c % vertex_columns());
+  };
+  if (i % 2 == 0) {
+    return {vertex_index(row, column), vertex_index(row, column + 1), vertex_index(row + 1, column + 1)};
+  }
+  return {vertex_index(row, column), vertex_index(row + 1, column + 1), vertex_index(row + 1, column)};
+}
+
+Triangle Parametric_Mesh::expanded_triangle(size_t i) const {
+  auto [a, b, c] = triangle(i);
+  Triangle t{{}, {vertex(a), vertex(b), vertex(c)}};
+  t.normal = (t.vertices[1] - t.vertices[0]).cross(t.vertices[2] - t.vertices[0]);
+  t.normal.normalize();
+  return t;
+}
+
+void write_parametric_mesh(const Parametric_Mesh &mesh, Mesh_File_Format format,
+                           const std::filesystem::path &filepath) {
+  std::ofstream ofs;
+  ofs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+  ofs.open(filepath, std::ofstream::binary);
+
+  if (format == Mesh_File_Format::Binary_STL) {
+    std::string header = make_binary_stl_header("meshproc generated mesh", mesh.num_triangles());
+    ofs.write(header.data(), static_cast<std::streamsize>(header.size()));
+    write_in_batches(ofs, mesh.num_triangles(), [&](size_t begin, size_t end, std::string &out) {
+      out.resize((end - begin) * BINARY_STL_RECORD_SIZE);
+      for (size_t i = begin; i < end; i++) {
+        store_binary_stl_record(out.data() + (i - begin) * BINARY_STL_RECORD_SIZE, mesh.expanded_triangle(i));
+      }
+    });
+  } else if (format == Mesh_File_Format::ASCII_STL) {
+    ofs << "solid meshproc\n";
+    write_in_batches(ofs, mesh.num_triangles(), [&](size_t begin, size_t end, std::string &out) {
+      for (size_t i = begin; i < end; i++) {
+        append_ascii_stl_facet(out, mesh.expanded_triangle(i));
+      }
+    });
+    ofs << "endsolid meshproc\n";
+  } else {
+    bool binary = format == Mesh_File_Format::Binary_PLY;
+    ofs << "ply\nformat " << (binary ? "binary_little_endian" : "ascii") << " 1.0\ncomment meshproc generated mesh\n";
+    ofs << "element vertex " << mesh.num_vertices() << "\nproperty float x\nproperty float y\nproperty float z\n";
+    ofs << "element face " << mesh.num_triangles() << "\nproperty list uchar uint vertex_indices\nend_header\n";
+    write_in_batches(ofs, mesh.num_vertices(), [&](size_t begin, size_t end, std::string &out) {
+      for (size_t i = begin; i < end; i++) {
+        Vec3f v = mesh.vertex(i);
+        if (binary) {
+          append_little_endian(out, v.x);
+          append_little_endian(out, v.y);
+          append_little_endian(out, v.z);
+        } else {
+          append_vec3f(out, v);
+          out += '\n';
+        }
+      }
+    });
+    write_in_batches(ofs, mesh.num_triangles(), [&](size_t begin, size_t end, std::string &out) {
+      for (size_t i = begin; i < end; i++) {
+        std::array<uint32_t, 3> indices = mesh.triangle(i);
+        if (binary) {
+          append_little_endian(out, uint8_t{3});
+          for (uint32_t index : indices) {
+            append_little_endian(out, index);
+          }
+        } else {
+          out += '3';
+          for (uint32_t index : indices) {
+            out += ' ';
+            append_number(out, index);
+          }
+          out += '\n';
+        }
+      }
+    });
+  }
+}
+
+} // namespace meshproc
@@ -0,0 +1,257 @@
+#pragma once
+
+/* Helpers shared by the meshproc_core sources, not part of the public interface */
+
+#include <meshproc.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit> // std::endian, std::bit_cast
+#include <charconv> // std::from_chars, std::to_chars
+#include <cstring> // std::memcpy
+#include <exception>
+#include <format>
+#include <fstream>
+#include <memory> // std::make_unique_for_overwrite
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHPROC_HAS_SSE2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h> // __cpuid
+// MSVC accepts AVX intrinsics in any function, GCC and Clang need the instruction set enabled per function
+#define MESHPROC_TARGET_AVX2
+#else
+#define MESHPROC_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace meshproc {
+
+constexpr size_t SOA_MIN_ITEMS_PER_THREAD = 1 << 16;
+
+// One per hardware thread, or fewer under a Scoped_Thread_Limit of the calling thread
+size_t calc_num_threads();
+
+/* Splits [0, num_items) into contiguous ranges, one per thread, and calls f(begin, end, range_index) for each.
+ * Fewer threads are used when a range would have less than `min_items_per_thread` items, so small inputs stay on
+ * the calling thread. Exceptions thrown by workers are rethrown on the calling thread once all of them finished.
+ */
+template <typename F> void parallel_for(size_t num_items, size_t min_items_per_thread, F &&f) {
+  size_t num_threads = std::clamp(num_items / std::max(min_items_per_thread, size_t{1}), size_t{1}, calc_num_threads());
+  if (num_threads == 1) {
+    f(size_t{0}, num_items, size_t{0});
+    return;
+  }
+  std::vector<std::exception_ptr> errors(num_threads);
+  auto run_range = [&](size_t range_index) {
+    try {
+      f(num_items * range_index / num_threads, num_items * (range_index + 1) / num_threads, range_index);
+    } catch (...) {
+      errors[range_index] = std::current_exception();
+    }
+  };
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t i = 1; i < num_threads; i++) {
+      threads.emplace_back(run_range, i);
+    }
+    run_range(0);
+  } // jthread joins on destruction
+  for (const std::exception_ptr &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+inline std::string_view as_text(std::span<const std::byte> bytes) {
+  return {reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+}
+
+inline bool is_space(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f'; }
+
+/* Whitespace separated tokenizer over an in-memory buffer, numbers are parsed with std::from_chars which is
+ * locale-independent and does not allocate
+ */
+class Text_Cursor {
+public:
+  /* `base_offset` is the position of `text` inside the whole file, only used for error messages */
+  explicit Text_Cursor(std::string_view text, size_t base_offset = 0) : text_(text), base_offset_(base_offset) {}
+
+  // Returns an empty token at the end of the text
+  std::string_view next_token() {
+    while (pos_ < text_.size() && is_space(text_[pos_])) {
+      pos_++;
+    }
+    size_t begin = pos_;
+    while (pos_ < text_.size() && !is_space(text_[pos_])) {
+      pos_++;
+    }
+    return text_.substr(begin, pos_ - begin);
+  }
+
+  template <typename T> T next_number() {
+    std::string_view token = next_token();
+    // from_chars rejects an explicit plus sign, which some exporters write
+    std::string_view digits = token.starts_with('+') ? token.substr(1) : token;
+    T value{};
+    auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    if (ec != std::errc() || end != digits.data() + digits.size()) {
+      throw std::domain_error(
+          std::format(R"(Expected a number at byte {} but found "{}")", offset() - token.size(), token));
+    }
+    return value;
+  }
+
+  Vec3f next_vec3f() {
+    float x = next_number<float>();
+    float y = next_number<float>();
+    float z = next_number<float>();
+    return {x, y, z};
+  }
+
+  void skip_line() {
+    size_t end = text_.find('\n', pos_);
+    pos_ = end == std::string_view::npos ? text_.size() : end + 1;
+  }
+
+  // Offset of the cursor from the start of the file
+  size_t offset() const { return base_offset_ + pos_; }
+
+  // Bytes left after the cursor
+  size_t remaining() const { return text_.size() - pos_; }
+
+private:
+  std::string_view text_;
+  size_t base_offset_;
+  size_t pos_ = 0;
+};
+
+// Regroups triangles produced in arbitrary amounts into TRIANGLE_BATCH_SIZE batches for a Triangle_Sink
+class Triangle_Batcher {
+public:
+  explicit Triangle_Batcher(const Triangle_Sink &sink) : sink_(sink) { batch_.reserve(TRIANGLE_BATCH_SIZE); }
+
+  void append(std::span<const Triangle> triangles) {
+    while (!triangles.empty()) {
+      size_t n = std::min(triangles.size(), TRIANGLE_BATCH_SIZE - batch_.size());
+      batch_.insert(batch_.end(), triangles.begin(), triangles.begin() + n);
+      triangles = triangles.subspan(n);
+      if (batch_.size() == TRIANGLE_BATCH_SIZE) {
+        flush();
+      }
+    }
+  }
+
+  // Delivers the last, partial batch
+  void flush() {
+    if (!batch_.empty()) {
+      sink_(batch_);
+      batch_.clear();
+    }
+  }
+
+private:
+  const Triangle_Sink &sink_;
+  std::vector<Triangle> batch_;
+};
+
+// splitmix64 finalizer, spreads every input bit over the whole output so the top bits can pick a shard
+inline uint64_t mix_bits(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ull;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBull;
+  x ^= x >> 31;
+  return x;
+}
+
+// Items formatted in memory before each write, bounds memory use whatever the mesh size
+constexpr size_t WRITER_BATCH_SIZE = 1 << 20;
+constexpr size_t WRITER_MIN_ITEMS_PER_THREAD = 1 << 14;
+
+// Appends the little endian representation of `value`, the byte order of binary STL and binary_little_endian PLY
+template <typename T> void append_little_endian(std::string &out, T value) {
+  auto raw = std::bit_cast<std::array<char, sizeof(T)>>(value);
+  if constexpr (std::endian::native == std::endian::big) {
+    std::ranges::reverse(raw);
+  }
+  out.append(raw.data(), raw.size());
+}
+
+// Shortest text that reads back to the same value, independent of the locale
+template <typename T> void append_number(std::string &out, T value) {
+  std::array<char, 32> buffer;
+  auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+  out.append(buffer.data(), end);
+}
+
+inline void append_vec3f(std::string &out, const Vec3f &v) {
+  append_number(out, v.x);
+  out += ' ';
+  append_number(out, v.y);
+  out += ' ';
+  append_number(out, v.z);
+}
+
+// Same as append_little_endian(), into a buffer that is already sized
+template <typename T> void store_little_endian(char *dst, T value) {
+  auto raw = std::bit_cast<std::array<char, sizeof(T)>>(value);
+  if constexpr (std::endian::native == std::endian::big) {
+    std::ranges::reverse(raw);
+  }
+  std::memcpy(dst, raw.data(), raw.size());
+}
+
+/* Same as write_in_batches() for records of `record_size` bytes: each batch is stored in parallel straight into one
+ * contiguous buffer, then written with a single call. store_record(i, dst) stores record i at dst.
+ */
+template <typename F>
+void write_records_in_batches(std::ofstream &ofs, size_t num_records, size_t record_size, F &&store_record) {
+  auto buffer = std::make_unique_for_overwrite<char[]>(std::min(num_records, WRITER_BATCH_SIZE) * record_size);
+  for (size_t batch_begin = 0; batch_begin < num_records; batch_begin += WRITER_BATCH_SIZE) {
+    size_t batch_size = std::min(WRITER_BATCH_SIZE, num_records - batch_begin);
+    parallel_for(batch_size, WRITER_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+      for (size_t i = begin; i < end; i++) {
+        store_record(batch_begin + i, buffer.get() + i * record_size);
+      }
+    });
+    ofs.write(buffer.get(), static_cast<std::streamsize>(batch_size * record_size));
+  }
+}
+
+/* STL formatting, shared by the STL writers and the mesh generator (defined in stl.cpp) */
+
+// Header (`description` padded with spaces) and triangle count, throws std::length_error past 2^32 - 1 triangles
+std::string make_binary_stl_header(std::string_view description, size_t num_triangles);
+// Stores BINARY_STL_RECORD_SIZE bytes at `dst`, with a zero attribute byte count
+void store_binary_stl_record(char *dst, const Triangle &t);
+void append_ascii_stl_facet(std::string &out, const Triangle &t);
+
+/* Calls format_range(begin, end, out) on ranges of [0, num_items) in parallel, one batch at a time, and writes the
+ * formatted ranges in order
+ */
+template <typename F> void write_in_batches(std::ofstream &ofs, size_t num_items, F &&format_range) {
+  std::vector<std::string> range_outputs(calc_num_threads());
+  for (size_t batch_begin = 0; batch_begin < num_items; batch_begin += WRITER_BATCH_SIZE) {
+    size_t batch_size = std::min(WRITER_BATCH_SIZE, num_items - batch_begin);
+    for (std::string &out : range_outputs) {
+      out.clear();
+    }
+    parallel_for(batch_size, WRITER_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t range_index) {
+      format_range(batch_begin + begin, batch_begin + end, range_outputs[range_index]);
+    });
+    for (const std::string &out : range_outputs) {
+      ofs.write(out.data(), static_cast<std::streamsize>(out.size()));
+    }
+  }
+}
+
+} // namespace meshproc
@@ -0,0 +1,101 @@
+#include <meshproc.hpp>
+
+#include <cerrno>
+#include <system_error>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace meshproc {
+
+Mapped_File::Mapped_File(const std::string &filepath) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw_last_error(filepath);
+  }
+  file_ = file;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    throw_last_error(filepath);
+  }
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  if (size_ == 0) {
+    return;
+  }
+  mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_ == nullptr) {
+    throw_last_error(filepath);
+  }
+  data_ = static_cast<const std::byte *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    throw_last_error(filepath);
+  }
+#else
+  int fd = open(filepath.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw_last_error(filepath);
+  }
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  void *data = nullptr;
+  if (ok) {
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ != 0) {
+      data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      ok = data != MAP_FAILED;
+    }
+  }
+  int error = errno;
+  close(fd); // The mapping keeps its own reference to the file
+  if (!ok) {
+    errno = error;
+    throw_last_error(filepath);
+  }
+  if (size_ == 0) {
+    return;
+  }
+  madvise(data, size_, MADV_SEQUENTIAL); // Only a hint, failure is harmless
+  data_ = static_cast<const std::byte *>(data);
+#endif
+}
+
+void Mapped_File::release() {
+#ifdef _WIN32
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+  if (file_ != nullptr) {
+    CloseHandle(file_);
+  }
+#else
+  if (data_ != nullptr) {
+    munmap(const_cast<std::byte *>(data_), size_);
+  }
+#endif
+}
+
+// The destructor does not run when the constructor throws, so handles opened so far are released here
+void Mapped_File::throw_last_error(const std::string &filepath) {
+#ifdef _WIN32
+  auto error = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+#else
+  auto error = std::error_code(errno, std::generic_category());
+#endif
+  release();
+  throw std::system_error(error, "Failed to map file: " + filepath);
+}
+
+} // namespace meshproc
@@ -0,0 +1,202 @@
+#include "internal.hpp"
+
+namespace meshproc {
+
+/* Face normals
+ *
+ * Normals are recomputed from the winding order for whole meshes at once. The kernels work on SIMD_WIDTH aligned
+ * ranges of SoA_Triangles, and use an approximate reciprocal square root refined with one Newton-Raphson step (about
+ * 22 bits of precision, against 23 for a float). Zero-area faces, including the zero padding, get a zero normal.
+ * The widest kernel supported by the CPU is picked at runtime.
+ */
+
+/* A face is treated as zero-area when the sine of the angle between its edges is below a few float epsilons, i.e.
+ * |e1 x e2|^2 <= |e1|^2 * |e2|^2 * DEGENERATE_SINE_SQUARED. An absolute threshold would not do: the cross product of
+ * collinear edges is only zero up to rounding, which depends on the edge lengths and on FMA contraction.
+ */
+constexpr float DEGENERATE_SINE_SQUARED = (4 * std::numeric_limits<float>::epsilon()) *
+                                          (4 * std::numeric_limits<float>::epsilon());
+constexpr size_t FACE_NORMALS_BLOCK_SIZE = 4096; // Triangles converted to SoA at once by recompute_normals()
+
+using Face_Normals_Kernel = void (*)(SoA_Triangles &triangles, size_t begin, size_t end);
+
+#ifndef MESHPROC_HAS_SSE2
+// Fallback for targets without SSE2, x86-64 always has it
+static void compute_face_normals_scalar(SoA_Triangles &triangles, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    Vec3f a = triangles.corners[0][i];
+    Vec3f e1 = triangles.corners[1][i] - a;
+    Vec3f e2 = triangles.corners[2][i] - a;
+    Vec3f normal = e1.cross(e2);
+    float length_squared = normal.x * normal.x + normal.y * normal.y + normal.z * normal.z;
+    float min_length_squared = (e1.x * e1.x + e1.y * e1.y + e1.z * e1.z) * (e2.x * e2.x + e2.y * e2.y + e2.z * e2.z) *
+                               DEGENERATE_SINE_SQUARED;
+    float inverse_length = length_squared > min_length_squared ? 1.0f / std::sqrt(length_squared) : 0.0f;
+    triangles.normals.set(i, normal * inverse_length);
+  }
+}
+#endif
+
+#ifdef MESHPROC_HAS_SSE2
+static void compute_face_normals_sse2(SoA_Triangles &triangles, size_t begin, size_t end) {
+  const SoA_Vec3_Array &a = triangles.corners[0];
+  const SoA_Vec3_Array &b = triangles.corners[1];
+  const SoA_Vec3_Array &c = triangles.corners[2];
+  SoA_Vec3_Array &n = triangles.normals;
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 three_halves = _mm_set1_ps(1.5f);
+  const __m128 degenerate_sine_squared = _mm_set1_ps(DEGENERATE_SINE_SQUARED);
+  for (size_t i = begin; i < end; i += 4) {
+    __m128 ax = _mm_load_ps(&a.x[i]);
+    __m128 ay = _mm_load_ps(&a.y[i]);
+    __m128 az = _mm_load_ps(&a.z[i]);
+    __m128 e1x = _mm_sub_ps(_mm_load_ps(&b.x[i]), ax);
+    __m128 e1y = _mm_sub_ps(_mm_load_ps(&b.y[i]), ay);
+    __m128 e1z = _mm_sub_ps(_mm_load_ps(&b.z[i]), az);
+    __m128 e2x = _mm_sub_ps(_mm_load_ps(&c.x[i]), ax);
+    __m128 e2y = _mm_sub_ps(_mm_load_ps(&c.y[i]), ay);
+    __m128 e2z = _mm_sub_ps(_mm_load_ps(&c.z[i]), az);
+    __m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+    __m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+    __m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+    __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+    __m128 e1_length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e1x), _mm_mul_ps(e1y, e1y)), _mm_mul_ps(e1z, e1z));
+    __m128 e2_length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, e2x), _mm_mul_ps(e2y, e2y)), _mm_mul_ps(e2z, e2z));
+    __m128 min_length_squared =
+        _mm_mul_ps(_mm_mul_ps(e1_length_squared, e2_length_squared), degenerate_sine_squared);
+    __m128 r = _mm_rsqrt_ps(length_squared);
+    // Newton-Raphson: r * (1.5 - 0.5 * x * r * r)
+    r = _mm_mul_ps(r, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, length_squared), _mm_mul_ps(r, r))));
+    r = _mm_and_ps(r, _mm_cmpgt_ps(length_squared, min_length_squared));
+    _mm_store_ps(&n.x[i], _mm_mul_ps(nx, r));
+    _mm_store_ps(&n.y[i], _mm_mul_ps(ny, r));
+    _mm_store_ps(&n.z[i], _mm_mul_ps(nz, r));
+  }
+}
+
+MESHPROC_TARGET_AVX2 static void compute_face_normals_avx2(SoA_Triangles &triangles, size_t begin, size_t end) {
+  const SoA_Vec3_Array &a = triangles.corners[0];
+  const SoA_Vec3_Array &b = triangles.corners[1];
+  const SoA_Vec3_Array &c = triangles.corners[2];
+  SoA_Vec3_Array &n = triangles.normals;
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 three_halves = _mm256_set1_ps(1.5f);
+  const __m256 degenerate_sine_squared = _mm256_set1_ps(DEGENERATE_SINE_SQUARED);
+  for (size_t i = begin; i < end; i += 8) {
+    __m256 ax = _mm256_load_ps(&a.x[i]);
+    __m256 ay = _mm256_load_ps(&a.y[i]);
+    __m256 az = _mm256_load_ps(&a.z[i]);
+    __m256 e1x = _mm256_sub_ps(_mm256_load_ps(&b.x[i]), ax);
+    __m256 e1y = _mm256_sub_ps(_mm256_load_ps(&b.y[i]), ay);
+    __m256 e1z = _mm256_sub_ps(_mm256_load_ps(&b.z[i]), az);
+    __m256 e2x = _mm256_sub_ps(_mm256_load_ps(&c.x[i]), ax);
+    __m256 e2y = _mm256_sub_ps(_mm256_load_ps(&c.y[i]), ay);
+    __m256 e2z = _mm256_sub_ps(_mm256_load_ps(&c.z[i]), az);
+    __m256 nx = _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e1z, e2y));
+    __m256 ny = _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e1x, e2z));
+    __m256 nz = _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e1y, e2x));
+    __m256 length_squared = _mm256_fmadd_ps(nx, nx, _mm256_fmadd_ps(ny, ny, _mm256_mul_ps(nz, nz)));
+    __m256 e1_length_squared = _mm256_fmadd_ps(e1x, e1x, _mm256_fmadd_ps(e1y, e1y, _mm256_mul_ps(e1z, e1z)));
+    __m256 e2_length_squared = _mm256_fmadd_ps(e2x, e2x, _mm256_fmadd_ps(e2y, e2y, _mm256_mul_ps(e2z, e2z)));
+    __m256 min_length_squared =
+        _mm256_mul_ps(_mm256_mul_ps(e1_length_squared, e2_length_squared), degenerate_sine_squared);
+    __m256 r = _mm256_rsqrt_ps(length_squared);
+    // Newton-Raphson: r * (1.5 - 0.5 * x * r * r)
+    r = _mm256_mul_ps(r, _mm256_fnmadd_ps(_mm256_mul_ps(half, length_squared), _mm256_mul_ps(r, r), three_halves));
+    r = _mm256_and_ps(r, _mm256_cmp_ps(length_squared, min_length_squared, _CMP_GT_OQ));
+    _mm256_store_ps(&n.x[i], _mm256_mul_ps(nx, r));
+    _mm256_store_ps(&n.y[i], _mm256_mul_ps(ny, r));
+    _mm256_store_ps(&n.z[i], _mm256_mul_ps(nz, r));
+  }
+}
+#endif
+
+static bool cpu_supports_avx2_fma() {
+#if defined(MESHPROC_HAS_SSE2) && defined(_MSC_VER)
+  std::array<int, 4> info;
+  __cpuid(info.data(), 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info.data(), 1);
+  bool has_fma = info[2] & (1 << 12);
+  bool has_osxsave = info[2] & (1 << 27);
+  bool has_avx = info[2] & (1 << 28);
+  // The OS must also save the upper halves of the AVX registers on context switches
+  if (!has_fma || !has_osxsave || !has_avx || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+  __cpuidex(info.data(), 7, 0);
+  return info[1] & (1 << 5);
+#elif defined(MESHPROC_HAS_SSE2)
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+  return false;
+#endif
+}
+
+static Face_Normals_Kernel select_face_normals_kernel() {
+#ifdef MESHPROC_HAS_SSE2
+  if (cpu_supports_avx2_fma()) {
+    return compute_face_normals_avx2;
+  }
+  return compute_face_normals_sse2;
+#else
+  return compute_face_normals_scalar;
+#endif
+}
+
+void compute_face_normals(SoA_Triangles &triangles) {
+  static const Face_Normals_Kernel kernel = select_face_normals_kernel();
+  // Arrays are padded to SIMD_WIDTH, so every range handed to the kernel is made of full registers
+  parallel_for(calc_padded_size(triangles.size()) / SIMD_WIDTH, SOA_MIN_ITEMS_PER_THREAD / SIMD_WIDTH,
+               [&](size_t begin, size_t end, size_t) { kernel(triangles, begin * SIMD_WIDTH, end * SIMD_WIDTH); });
+}
+
+void recompute_normals(std::span<Triangle> triangles) {
+  static const Face_Normals_Kernel kernel = select_face_normals_kernel();
+  parallel_for(triangles.size(), SOA_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    SoA_Triangles block;
+    block.resize(FACE_NORMALS_BLOCK_SIZE);
+    for (size_t block_begin = begin; block_begin < end; block_begin += FACE_NORMALS_BLOCK_SIZE) {
+      size_t block_size = std::min(FACE_NORMALS_BLOCK_SIZE, end - block_begin);
+      for (size_t i = 0; i < block_size; i++) {
+        for (size_t j = 0; j < 3; j++) {
+          block.corners[j].set(i, triangles[block_begin + i].vertices[j]);
+        }
+      }
+      kernel(block, 0, calc_padded_size(block_size));
+      for (size_t i = 0; i < block_size; i++) {
+        triangles[block_begin + i].normal = block.normals[i];
+      }
+    }
+  });
+}
+
+void append_triangle_soup(const Indexed_Mesh &mesh, std::vector<Triangle> &triangles) {
+  size_t first_triangle = triangles.size();
+  triangles.resize(first_triangle + mesh.num_triangles());
+  for (size_t i = 0; i < mesh.num_triangles(); i++) {
+    for (size_t j = 0; j < 3; j++) {
+      triangles[first_triangle + i].vertices[j] = mesh.vertices[mesh.indices[i * 3 + j]];
+    }
+  }
+  recompute_normals(std::span(triangles).subspan(first_triangle));
+}
+
+void stream_triangle_soup(const Indexed_Mesh &mesh, const Triangle_Sink &sink) {
+  std::vector<Triangle> batch(std::min(mesh.num_triangles(), TRIANGLE_BATCH_SIZE));
+  for (size_t batch_begin = 0; batch_begin < mesh.num_triangles(); batch_begin += TRIANGLE_BATCH_SIZE) {
+    size_t batch_size = std::min(TRIANGLE_BATCH_SIZE, mesh.num_triangles() - batch_begin);
+    for (size_t i = 0; i < batch_size; i++) {
+      for (size_t j = 0; j < 3; j++) {
+        batch[i].vertices[j] = mesh.vertices[mesh.indices[(batch_begin + i) * 3 + j]];
+      }
+    }
+    std::span<Triangle> triangles = std::span(batch).first(batch_size);
+    recompute_normals(triangles);
+    sink(triangles);
+  }
+}
+
+} // namespace meshproc
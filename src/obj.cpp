@@ -0,0 +1,128 @@
+#include "internal.hpp"
+
+namespace meshproc {
+
+// OBJ files smaller than this are parsed on the calling thread
+constexpr size_t OBJ_MIN_CHUNK_SIZE = 1 << 20;
+
+/* Result of parsing one line-aligned chunk. Faces are fan-triangulated, their corners are 0-based vertex indices.
+ * Negative references count back from the last vertex defined before the face, which depends on the vertices of the
+ * previous chunks: they are stored relative to the first vertex of the chunk and listed in `relative_corners` until
+ * the chunk offsets are known.
+ */
+struct OBJ_Chunk {
+  std::vector<Vec3f> vertices;
+  std::vector<int64_t> indices;
+  std::vector<size_t> relative_corners; // Positions in `indices`
+};
+
+// Vertex reference of a face corner: "v", "v/vt", "v//vn" or "v/vt/vn", texture and normal references are ignored
+static int64_t parse_obj_corner(std::string_view token, size_t offset) {
+  std::string_view digits = token.substr(0, token.find('/'));
+  int64_t index = 0;
+  auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), index);
+  if (ec != std::errc() || end != digits.data() + digits.size() || index == 0) {
+    throw std::domain_error(std::format(R"(Expected a vertex reference at byte {} but found "{}")", offset, token));
+  }
+  return index;
+}
+
+static void parse_obj_chunk(std::string_view chunk, size_t chunk_offset, OBJ_Chunk &result) {
+  std::vector<int64_t> face;
+  for (size_t line_begin = 0; line_begin < chunk.size();) {
+    size_t line_end = std::min(chunk.find('\n', line_begin), chunk.size());
+    std::string_view line = chunk.substr(line_begin, line_end - line_begin);
+    line = line.substr(0, line.find('#')); // Comments may also follow the data on a line
+    Text_Cursor cursor(line, chunk_offset + line_begin);
+    line_begin = line_end + 1;
+
+    std::string_view keyword = cursor.next_token();
+    if (keyword == "v") {
+      result.vertices.push_back(cursor.next_vec3f()); // An optional w coordinate or vertex color follows
+    } else if (keyword == "f") {
+      face.clear();
+      for (std::string_view token = cursor.next_token(); !token.empty(); token = cursor.next_token()) {
+        face.push_back(parse_obj_corner(token, cursor.offset() - token.size()));
+      }
+      if (face.size() < 3) {
+        throw std::domain_error(std::format("Expected face to have at least 3 vertices, but found {}", face.size()));
+      }
+      for (size_t i = 1; i + 1 < face.size(); i++) {
+        for (int64_t index : {face[0], face[i], face[i + 1]}) {
+          if (index < 0) {
+            result.relative_corners.push_back(result.indices.size());
+            result.indices.push_back(static_cast<int64_t>(result.vertices.size()) + index);
+          } else {
+            result.indices.push_back(index - 1);
+          }
+        }
+      }
+    }
+    // "vt", "vn", groups, materials, lines and points do not contribute to the mesh
+  }
+}
+
+void read_obj(std::span<const std::byte> bytes, Indexed_Mesh &mesh) {
+  std::string_view text = as_text(bytes);
+  size_t num_chunks = std::clamp(text.size() / OBJ_MIN_CHUNK_SIZE, size_t{1}, calc_num_threads());
+  std::vector<size_t> chunk_begins(num_chunks + 1, text.size());
+  chunk_begins[0] = 0;
+  for (size_t i = 1; i < num_chunks; i++) {
+    size_t line_end = text.find('\n', std::max(chunk_begins[i - 1], text.size() * i / num_chunks));
+    chunk_begins[i] = line_end == std::string_view::npos ? text.size() : line_end + 1;
+  }
+  std::vector<OBJ_Chunk> chunks(num_chunks);
+  parallel_for(num_chunks, 1, [&](size_t begin, size_t end, size_t) {
+    for (size_t i = begin; i < end; i++) {
+      std::string_view chunk = text.substr(chunk_begins[i], chunk_begins[i + 1] - chunk_begins[i]);
+      parse_obj_chunk(chunk, chunk_begins[i], chunks[i]);
+    }
+  });
+
+  // Where each chunk goes in the mesh, the vertex offsets also resolve the relative references
+  std::vector<size_t> vertex_offsets(num_chunks + 1, mesh.vertices.size());
+  std::vector<size_t> index_offsets(num_chunks + 1, mesh.indices.size());
+  for (size_t i = 0; i < num_chunks; i++) {
+    vertex_offsets[i + 1] = vertex_offsets[i] + chunks[i].vertices.size();
+    index_offsets[i + 1] = index_offsets[i] + chunks[i].indices.size();
+  }
+  size_t first_vertex = mesh.vertices.size();
+  size_t num_vertices = vertex_offsets.back() - first_vertex;
+  if (vertex_offsets.back() > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error(std::format("Cannot index {} vertices with 32 bits indices", vertex_offsets.back()));
+  }
+  mesh.vertices.resize(vertex_offsets.back());
+  mesh.indices.resize(index_offsets.back());
+  parallel_for(num_chunks, 1, [&](size_t begin, size_t end, size_t) {
+    for (size_t i = begin; i < end; i++) {
+      OBJ_Chunk &chunk = chunks[i];
+      std::ranges::copy(chunk.vertices, mesh.vertices.begin() + static_cast<ptrdiff_t>(vertex_offsets[i]));
+      for (size_t corner : chunk.relative_corners) {
+        chunk.indices[corner] += static_cast<int64_t>(vertex_offsets[i] - first_vertex);
+      }
+      for (size_t j = 0; j < chunk.indices.size(); j++) {
+        int64_t index = chunk.indices[j];
+        if (index < 0 || static_cast<size_t>(index) >= num_vertices) {
+          // Reported 1-based, as written in the file
+          throw std::out_of_range(
+              std::format("Face references vertex {} but there are only {} vertices", index + 1, num_vertices));
+        }
+        mesh.indices[index_offsets[i] + j] = static_cast<uint32_t>(first_vertex + static_cast<size_t>(index));
+      }
+    }
+  });
+}
+
+void read_obj(std::span<const std::byte> bytes, std::vector<Triangle> &triangles) {
+  Indexed_Mesh mesh;
+  read_obj(bytes, mesh);
+  append_triangle_soup(mesh, triangles);
+}
+
+void read_obj(std::span<const std::byte> bytes, const Triangle_Sink &sink) {
+  Indexed_Mesh mesh;
+  read_obj(bytes, mesh);
+  stream_triangle_soup(mesh, sink);
+}
+
+} // namespace meshproc
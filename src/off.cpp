@@ -0,0 +1,111 @@
+#include "internal.hpp"
+
+namespace meshproc {
+
+/* Returns the next line holding data as a cursor, with the '#' comment stripped, or std::nullopt at the end of the
+ * text. `pos` is moved past that line.
+ */
+static std::optional<Text_Cursor> next_off_line(std::string_view text, size_t &pos) {
+  while (pos < text.size()) {
+    size_t line_end = std::min(text.find('\n', pos), text.size());
+    std::string_view line = text.substr(pos, line_end - pos);
+    line = line.substr(0, line.find('#'));
+    size_t line_begin = pos;
+    pos = line_end + 1;
+    if (std::ranges::any_of(line, [](char c) { return !is_space(c); })) {
+      return Text_Cursor(line, line_begin);
+    }
+  }
+  return std::nullopt;
+}
+
+void read_off(std::span<const std::byte> bytes, Indexed_Mesh &mesh) {
+  std::string_view text = as_text(bytes);
+  size_t pos = 0;
+  auto next_line = [&] {
+    std::optional<Text_Cursor> line = next_off_line(text, pos);
+    if (!line) {
+      throw std::domain_error("Unexpected end of OFF file");
+    }
+    return *line;
+  };
+
+  Text_Cursor header = next_line();
+  std::string_view keyword = header.next_token();
+  std::string_view prefix = keyword.substr(0, keyword.size() - std::min(keyword.size(), size_t{3}));
+  if (!keyword.ends_with("OFF") || prefix.find_first_not_of("STCN4n") != std::string_view::npos) {
+    throw std::domain_error(std::format(R"(Expected an OFF header but found "{}")", keyword));
+  }
+  bool homogeneous = prefix.find('4') != std::string_view::npos;
+  // The dimension and counts usually have their own lines but may follow the keyword
+  Text_Cursor fields = header;
+  auto next_header_number = [&] {
+    if (Text_Cursor peek = fields; peek.next_token().empty()) {
+      fields = next_line();
+    }
+    return fields.next_number<size_t>();
+  };
+  if (prefix.find('n') != std::string_view::npos) {
+    if (size_t dimension = next_header_number(); dimension != 3) {
+      throw std::domain_error(std::format("Expected 3 dimensional OFF vertices but found {} dimensions", dimension));
+    }
+  }
+  size_t num_vertices = next_header_number();
+  size_t num_faces = next_header_number();
+  // The edge count that follows is not used
+
+  size_t first_vertex = mesh.vertices.size();
+  if (first_vertex + num_vertices > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error(std::format("Cannot index {} vertices with 32 bits indices", first_vertex + num_vertices));
+  }
+  // Counts come from the file, a bogus one fails on the missing lines instead of reserving huge buffers
+  mesh.vertices.reserve(first_vertex + std::min(num_vertices, text.size() / 6));
+  for (size_t i = 0; i < num_vertices; i++) {
+    Text_Cursor line = next_line();
+    Vec3f v = line.next_vec3f(); // Normals, colors and texture coordinates follow
+    if (homogeneous) {
+      v = v / line.next_number<float>();
+    }
+    mesh.vertices.push_back(v);
+  }
+
+  mesh.indices.reserve(mesh.indices.size() + std::min(num_faces, text.size() / 8) * 3);
+  for (size_t i = 0; i < num_faces; i++) {
+    Text_Cursor line = next_line();
+    size_t face_size = line.next_number<size_t>();
+    if (face_size < 3) {
+      throw std::domain_error(std::format("Expected face to have at least 3 vertices, but found {}", face_size));
+    }
+    // Polygons are fan-triangulated as they are read, a face color may follow the indices
+    uint32_t first_corner = 0;
+    uint32_t previous_corner = 0;
+    for (size_t j = 0; j < face_size; j++) {
+      size_t vertex_index = line.next_number<size_t>();
+      if (vertex_index >= num_vertices) {
+        throw std::out_of_range(std::format("Face {} references vertex {} but there are only {} vertices", i,
+                                            vertex_index, num_vertices));
+      }
+      auto corner = static_cast<uint32_t>(first_vertex + vertex_index);
+      if (j == 0) {
+        first_corner = corner;
+      } else if (j >= 2) {
+        mesh.indices.insert(mesh.indices.end(), {first_corner, previous_corner, corner});
+      }
+      previous_corner = corner;
+    }
+  }
+}
+
+void read_off(std::span<const std::byte> bytes, std::vector<Triangle> &triangles) {
+  Indexed_Mesh mesh;
+  read_off(bytes, mesh);
+  append_triangle_soup(mesh, triangles);
+}
+
+void read_off(std::span<const std::byte> bytes, const Triangle_Sink &sink) {
+  Indexed_Mesh mesh;
+  read_off(bytes, mesh);
+  stream_triangle_soup(mesh, sink);
+}
+
+} // namespace meshproc
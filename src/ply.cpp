@@ -0,0 +1,761 @@
+#include "internal.hpp"
+
+#include <atomic>
+#include <numeric> // std::iota
+#include <type_traits>
+
+namespace meshproc {
+
+// Accepts both the original type names and the sized aliases (int8, uint8, ..., float64)
+static PLY_Scalar_Type parse_ply_scalar_type(std::string_view name) {
+  using enum PLY_Scalar_Type;
+  static const std::array<std::pair<std::string_view, PLY_Scalar_Type>, 16> names{{
+      {"char", Char},
+      {"int8", Char},
+      {"uchar", UChar},
+      {"uint8", UChar},
+      {"short", Short},
+      {"int16", Short},
+      {"ushort", UShort},
+      {"uint16", UShort},
+      {"int", Int},
+      {"int32", Int},
+      {"uint", UInt},
+      {"uint32", UInt},
+      {"float", Float},
+      {"float32", Float},
+      {"double", Double},
+      {"float64", Double},
+  }};
+  for (const auto &[type_name, type] : names) {
+    if (type_name == name) {
+      return type;
+    }
+  }
+  throw std::domain_error(std::format(R"(Unknown PLY property type "{}")", name));
+}
+
+/* Calls f with a value-initialized object of the C++ type matching `type`, so the caller can be written once as a
+ * generic lambda and get one instantiation per PLY type
+ */
+template <typename F> static decltype(auto) visit_ply_scalar_type(PLY_Scalar_Type type, F &&f) {
+  switch (type) {
+  case PLY_Scalar_Type::Char:
+    return f(int8_t{});
+  case PLY_Scalar_Type::UChar:
+    return f(uint8_t{});
+  case PLY_Scalar_Type::Short:
+    return f(int16_t{});
+  case PLY_Scalar_Type::UShort:
+    return f(uint16_t{});
+  case PLY_Scalar_Type::Int:
+    return f(int32_t{});
+  case PLY_Scalar_Type::UInt:
+    return f(uint32_t{});
+  case PLY_Scalar_Type::Float:
+    return f(float{});
+  case PLY_Scalar_Type::Double:
+    return f(double{});
+  }
+  throw std::domain_error("Invalid PLY scalar type");
+}
+
+struct PLY_Property_Definition {
+  enum class Type {
+    List,
+    Scalar,
+  };
+  Type type;
+  std::string_view name; // Points into the header
+  PLY_Scalar_Type value_type; // Type of the scalar, or of the list items
+  PLY_Scalar_Type count_type; // Type of the list item count, unused for scalars
+};
+
+struct PLY_Element_Definition {
+  std::string_view name; // Points into the header
+  size_t count;
+  std::pmr::vector<PLY_Property_Definition> property_definitions;
+};
+
+// Header definitions of a typical file fit on the stack, larger ones spill to the heap
+constexpr size_t PLY_HEADER_ARENA_SIZE = 4096;
+// Fixed size records of binary elements, fewer are decoded on the calling thread
+constexpr size_t PLY_MIN_RECORDS_PER_THREAD = 1 << 15;
+// Records decoded column by column at a time, small enough to stay in cache until the last column is done
+constexpr size_t PLY_RECORDS_PER_BLOCK = 1 << 12;
+
+// Loads a scalar of a binary PLY body, swapping its bytes when the file endianness is not native
+template <typename T> static T load_ply_scalar(const std::byte *p, bool swap_bytes) {
+  std::array<std::byte, sizeof(T)> raw;
+  std::memcpy(raw.data(), p, sizeof(T));
+  if (swap_bytes) {
+    std::ranges::reverse(raw); // Compilers turn this into a single bswap instruction
+  }
+  return std::bit_cast<T>(raw);
+}
+
+// Reads scalars of a binary PLY body one after another
+class PLY_Binary_Reader {
+public:
+  PLY_Binary_Reader(std::span<const std::byte> body, std::endian file_endianness)
+      : body_(body), swap_bytes_(file_endianness != std::endian::native) {}
+
+  template <typename T> T read() {
+    if (body_.size() - pos_ < sizeof(T)) {
+      throw PLY_Unexpected_End_Of_Data_Error();
+    }
+    pos_ += sizeof(T);
+    return load_ply_scalar<T>(body_.data() + pos_ - sizeof(T), swap_bytes_);
+  }
+
+  // Returns the next `size` bytes and moves past them
+  std::span<const std::byte> read_bytes(size_t size) {
+    if (body_.size() - pos_ < size) {
+      throw PLY_Unexpected_End_Of_Data_Error();
+    }
+    pos_ += size;
+    return body_.subspan(pos_ - size, size);
+  }
+
+  size_t remaining() const { return body_.size() - pos_; }
+  std::span<const std::byte> remaining_bytes() const { return body_.subspan(pos_); }
+  bool swaps_bytes() const { return swap_bytes_; }
+
+private:
+  std::span<const std::byte> body_;
+  size_t pos_ = 0;
+  bool swap_bytes_;
+};
+
+// Reads one value of a PLY body, so that decoders are written once for both kinds of body
+template <typename T> static T read_ply_value(Text_Cursor &cursor) { return cursor.next_number<T>(); }
+template <typename T> static T read_ply_value(PLY_Binary_Reader &reader) { return reader.read<T>(); }
+
+// ASCII list sizes are read as plain numbers whatever their declared type, binary ones need it to know their width
+template <typename Count> static size_t read_ply_list_size(Text_Cursor &cursor) {
+  return cursor.next_number<size_t>();
+}
+template <typename Count> static size_t read_ply_list_size(PLY_Binary_Reader &reader) {
+  return static_cast<size_t>(reader.read<Count>());
+}
+
+/* Upper bound of the records the rest of the body can hold, element counts come from the header and are not trusted
+ * for sizing columns. An ASCII value takes at least a digit and a separator, except the very last one of the file.
+ */
+static size_t calc_max_ply_records(const PLY_Element_Definition &, const Text_Cursor &cursor) {
+  return cursor.remaining() / 2 + 1;
+}
+static size_t calc_max_ply_records(const PLY_Element_Definition &ed, const PLY_Binary_Reader &reader) {
+  size_t min_record_size = 0; // Lists may be empty, leaving only their count
+  for (const PLY_Property_Definition &pd : ed.property_definitions) {
+    PLY_Scalar_Type type = pd.type == PLY_Property_Definition::Type::Scalar ? pd.value_type : pd.count_type;
+    min_record_size += visit_ply_scalar_type(type, [](auto value_tag) { return sizeof(value_tag); });
+  }
+  return min_record_size > 0 ? reader.remaining() / min_record_size : ed.count;
+}
+
+/* Looks up the column of every property once per element definition, so decoding values is a plain store.
+ * Columns are allocated from the arena of `parsed_ply`: scalars are sized up front for `num_records` and element i
+ * stores its value at i, lists are appended to and reserved for triangles, capped by the size of the body. A list
+ * column outgrowing its reservation leaves its old buffer unused in the arena, which the guess avoids for the common
+ * case.
+ */
+static std::pmr::vector<PLY_Property *> prepare_ply_columns(const PLY_Element_Definition &ed, size_t num_records,
+                                                            size_t body_size, Parsed_PLY &parsed_ply,
+                                                            std::pmr::memory_resource *scratch) {
+  std::pmr::memory_resource *arena = parsed_ply.arena.get();
+  auto [element_it, inserted] = parsed_ply.elements_map.try_emplace(std::pmr::string(ed.name, arena), arena);
+  PLY_Element &element = element_it->second;
+  element.count = ed.count;
+  std::pmr::vector<PLY_Property *> columns(scratch);
+  for (const PLY_Property_Definition &pd : ed.property_definitions) {
+    PLY_Property &property = element.property_map.try_emplace(std::pmr::string(pd.name, arena), arena).first->second;
+    visit_ply_scalar_type(pd.value_type, [&](auto value_tag) {
+      auto &values = property.values.emplace<std::pmr::vector<decltype(value_tag)>>(arena);
+      if (pd.type == PLY_Property_Definition::Type::Scalar) {
+        values.resize(num_records);
+      } else {
+        values.reserve(std::min(num_records * 3, body_size / sizeof(decltype(value_tag))));
+      }
+    });
+    if (pd.type == PLY_Property_Definition::Type::List) {
+      property.offsets.resize(num_records + 1);
+    }
+    columns.push_back(&property);
+  }
+  return columns;
+}
+
+/* Step of a decode plan: reads one property of element i into its column. `decode` is instantiated for the types of
+ * the property, so running a plan only costs an indirect call per property.
+ */
+template <typename Reader> struct PLY_Decode_Op {
+  void (*decode)(const PLY_Decode_Op &op, size_t i, Reader &reader);
+  void *values;           // Scalars: data of the column, sized for all the elements
+  PLY_Property *property; // Lists: the column appended to, and its offsets
+};
+
+template <typename Reader, typename T> static void decode_ply_scalar(const PLY_Decode_Op<Reader> &op, size_t i,
+                                                                     Reader &reader) {
+  static_cast<T *>(op.values)[i] = read_ply_value<T>(reader);
+}
+
+template <typename Reader, typename Count, typename T>
+static void decode_ply_list(const PLY_Decode_Op<Reader> &op, size_t i, Reader &reader) {
+  auto &values = std::get<std::pmr::vector<T>>(op.property->values);
+  size_t num_values = read_ply_list_size<Count>(reader);
+  for (size_t j = 0; j < num_values; j++) {
+    values.push_back(read_ply_value<T>(reader));
+  }
+  op.property->offsets[i + 1] = values.size();
+}
+
+// Compiles the property definitions of an element into the ops decoding them, in file order
+template <typename Reader>
+static std::pmr::vector<PLY_Decode_Op<Reader>> compile_ply_decode_plan(const PLY_Element_Definition &ed,
+                                                                       std::span<PLY_Property *const> columns,
+                                                                       std::pmr::memory_resource *scratch) {
+  std::pmr::vector<PLY_Decode_Op<Reader>> plan(scratch);
+  for (size_t j = 0; j < columns.size(); j++) {
+    const PLY_Property_Definition &pd = ed.property_definitions[j];
+    PLY_Decode_Op<Reader> &op = plan.emplace_back(PLY_Decode_Op<Reader>{nullptr, nullptr, columns[j]});
+    visit_ply_scalar_type(pd.value_type, [&](auto value_tag) {
+      using T = decltype(value_tag);
+      if (pd.type == PLY_Property_Definition::Type::Scalar) {
+        op.decode = decode_ply_scalar<Reader, T>;
+        op.values = std::get<std::pmr::vector<T>>(columns[j]->values).data();
+        return;
+      }
+      visit_ply_scalar_type(pd.count_type, [&](auto count_tag) {
+        if constexpr (std::is_floating_point_v<decltype(count_tag)>) {
+          throw std::domain_error(std::format(R"(PLY list "{}" has a floating point count type)", pd.name));
+        } else {
+          op.decode = decode_ply_list<Reader, decltype(count_tag), T>;
+        }
+      });
+    });
+  }
+  return plan;
+}
+
+/* Fast paths for the most common elements, decoded without any per-value dispatch: vertices made of scalars only
+ * (positions, with normals or colors) and faces made of a single list. Binary elements of scalars only or of a
+ * single list have their own parallel paths instead.
+ */
+
+template <typename... Ts, typename Reader>
+static void decode_ply_scalar_elements(Reader &reader, size_t count, Ts *...columns) {
+  for (size_t i = 0; i < count; i++) {
+    ((columns[i] = read_ply_value<Ts>(reader)), ...); // Folded over the comma operator, so in property order
+  }
+}
+
+template <typename Count, typename T, typename Reader>
+static void decode_ply_list_elements(Reader &reader, size_t count, PLY_Property &property) {
+  auto &values = std::get<std::pmr::vector<T>>(property.values);
+  for (size_t i = 0; i < count; i++) {
+    size_t num_values = read_ply_list_size<Count>(reader);
+    for (size_t j = 0; j < num_values; j++) {
+      values.push_back(read_ply_value<T>(reader));
+    }
+    property.offsets[i + 1] = values.size();
+  }
+}
+
+// Returns false when the element has no fast path and must be decoded by a plan
+template <typename Reader>
+static bool decode_ply_common_element(const PLY_Element_Definition &ed, std::span<PLY_Property *const> columns,
+                                      Reader &reader) {
+  using enum PLY_Scalar_Type;
+  using Type = PLY_Property_Definition::Type;
+  const std::pmr::vector<PLY_Property_Definition> &pds = ed.property_definitions;
+  auto column = [&]<typename T>(size_t j, T) { return std::get<std::pmr::vector<T>>(columns[j]->values).data(); };
+  auto has_scalars = [&](std::initializer_list<PLY_Scalar_Type> types) {
+    return std::ranges::equal(pds, types, [](const PLY_Property_Definition &pd, PLY_Scalar_Type type) {
+      return pd.type == Type::Scalar && pd.value_type == type;
+    });
+  };
+
+  if (has_scalars({Float, Float, Float})) {
+    decode_ply_scalar_elements(reader, ed.count, column(0, float{}), column(1, float{}), column(2, float{}));
+  } else if (has_scalars({Float, Float, Float, Float, Float, Float})) {
+    decode_ply_scalar_elements(reader, ed.count, column(0, float{}), column(1, float{}), column(2, float{}),
+                               column(3, float{}), column(4, float{}), column(5, float{}));
+  } else if (has_scalars({Float, Float, Float, UChar, UChar, UChar})) {
+    decode_ply_scalar_elements(reader, ed.count, column(0, float{}), column(1, float{}), column(2, float{}),
+                               column(3, uint8_t{}), column(4, uint8_t{}), column(5, uint8_t{}));
+  } else if (pds.size() == 1 && pds[0].type == Type::List && pds[0].count_type == UChar && pds[0].value_type == Int) {
+    decode_ply_list_elements<uint8_t, int32_t>(reader, ed.count, *columns[0]);
+  } else if (pds.size() == 1 && pds[0].type == Type::List && pds[0].count_type == UChar && pds[0].value_type == UInt) {
+    decode_ply_list_elements<uint8_t, uint32_t>(reader, ed.count, *columns[0]);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/* Copies the property found `offset` bytes into each record of [begin, end) to its column. Records are `stride` bytes
+ * apart and the byte order is fixed at compile time, so the loop body is a load, an optional bswap and a store.
+ */
+template <typename T, bool Swap>
+static void decode_ply_strided_column(const std::byte *records, size_t stride, size_t offset, size_t begin, size_t end,
+                                      T *column) {
+  for (size_t i = begin; i < end; i++) {
+    column[i] = load_ply_scalar<T>(records + i * stride + offset, Swap);
+  }
+}
+
+/* Decodes a binary element made of scalars only. Its records all have the same size, so record i starts at
+ * i * stride: the block is bounds checked once, then split across threads by record index and decoded straight from
+ * the file, one column after the other over blocks of records.
+ */
+static void decode_ply_fixed_stride_element(const PLY_Element_Definition &ed, std::span<PLY_Property *const> columns,
+                                            PLY_Binary_Reader &reader) {
+  size_t stride = 0;
+  for (const PLY_Property_Definition &pd : ed.property_definitions) {
+    stride += visit_ply_scalar_type(pd.value_type, [](auto value_tag) { return sizeof(value_tag); });
+  }
+  if (ed.count > reader.remaining() / stride) {
+    throw PLY_Unexpected_End_Of_Data_Error();
+  }
+  const std::byte *records = reader.read_bytes(ed.count * stride).data();
+  bool swap_bytes = reader.swaps_bytes();
+  parallel_for(ed.count, PLY_MIN_RECORDS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    for (size_t block_begin = begin; block_begin < end; block_begin += PLY_RECORDS_PER_BLOCK) {
+      size_t block_end = std::min(block_begin + PLY_RECORDS_PER_BLOCK, end);
+      size_t offset = 0;
+      for (size_t j = 0; j < columns.size(); j++) {
+        visit_ply_scalar_type(ed.property_definitions[j].value_type, [&](auto value_tag) {
+          using T = decltype(value_tag);
+          T *column = std::get<std::pmr::vector<T>>(columns[j]->values).data();
+          if (swap_bytes) {
+            decode_ply_strided_column<T, true>(records, stride, offset, block_begin, block_end, column);
+          } else {
+            decode_ply_strided_column<T, false>(records, stride, offset, block_begin, block_end, column);
+          }
+          offset += sizeof(T);
+        });
+      }
+    }
+  });
+}
+
+// Decodes records of triangles, returns false at the first record that is not a triangle
+template <typename Count, typename T, bool Swap>
+static bool decode_ply_triangle_records(const std::byte *records, size_t begin, size_t end, T *values) {
+  constexpr size_t stride = sizeof(Count) + 3 * sizeof(T);
+  for (size_t i = begin; i < end; i++) {
+    const std::byte *record = records + i * stride;
+    if (load_ply_scalar<Count>(record, Swap) != Count{3}) {
+      return false;
+    }
+    decode_ply_strided_column<T, Swap>(record + sizeof(Count), sizeof(T), 0, 0, 3, values + i * 3);
+  }
+  return true;
+}
+
+/* Decodes a binary element made of a single list, the faces of a mesh, in parallel.
+ * Meshes are usually all triangles, which makes records a fixed size: that is tried first, and it is verified since
+ * record 0 being a triangle places record 1 where expected, and so on. Otherwise records are decoded in two phases:
+ * a walk over the counts finds where every list goes, then the lists are decoded in parallel into the column sized
+ * from that. Each record position depends on all the previous counts, so the walk is sequential, but it only loads
+ * one count per record.
+ */
+template <typename Count, typename T, bool Swap>
+static void decode_ply_list_element(const PLY_Element_Definition &ed, PLY_Property &property,
+                                    PLY_Binary_Reader &reader) {
+  auto &values = std::get<std::pmr::vector<T>>(property.values);
+  std::pmr::vector<size_t> &offsets = property.offsets;
+  std::span<const std::byte> bytes = reader.remaining_bytes();
+
+  constexpr size_t triangle_stride = sizeof(Count) + 3 * sizeof(T);
+  if (ed.count <= bytes.size() / triangle_stride) {
+    values.resize(ed.count * 3);
+    std::atomic<bool> all_triangles = true;
+    parallel_for(ed.count, PLY_MIN_RECORDS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+      if (!decode_ply_triangle_records<Count, T, Swap>(bytes.data(), begin, end, values.data())) {
+        all_triangles = false;
+      }
+      for (size_t i = begin; i < end; i++) {
+        offsets[i + 1] = (i + 1) * 3;
+      }
+    });
+    if (all_triangles) {
+      reader.read_bytes(ed.count * triangle_stride);
+      return;
+    }
+  }
+
+  size_t pos = 0;
+  for (size_t i = 0; i < ed.count; i++) {
+    if (bytes.size() - pos < sizeof(Count)) {
+      throw PLY_Unexpected_End_Of_Data_Error();
+    }
+    auto num_values = static_cast<size_t>(load_ply_scalar<Count>(bytes.data() + pos, Swap)); // Negative ones wrap
+    pos += sizeof(Count);
+    if (num_values > (bytes.size() - pos) / sizeof(T)) {
+      throw PLY_Unexpected_End_Of_Data_Error();
+    }
+    pos += num_values * sizeof(T);
+    offsets[i + 1] = offsets[i] + num_values;
+  }
+  values.resize(offsets.back());
+  parallel_for(ed.count, PLY_MIN_RECORDS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    for (size_t i = begin; i < end; i++) {
+      // Record i starts after i counts and the offsets[i] values of the previous lists
+      const std::byte *list = bytes.data() + (i + 1) * sizeof(Count) + offsets[i] * sizeof(T);
+      size_t num_values = offsets[i + 1] - offsets[i];
+      decode_ply_strided_column<T, Swap>(list, sizeof(T), 0, 0, num_values, values.data() + offsets[i]);
+    }
+  });
+  reader.read_bytes(pos);
+}
+
+template <typename Reader>
+static void decode_ply_element(const PLY_Element_Definition &ed, Reader &reader, Parsed_PLY &parsed_ply,
+                               std::pmr::memory_resource *scratch) {
+  // A binary body too short for the count is rejected before anything is sized. An ASCII one fails on the first
+  // missing value instead, which is read before any record past the bound would be stored
+  size_t num_records = std::min(ed.count, calc_max_ply_records(ed, reader));
+  if constexpr (std::is_same_v<Reader, PLY_Binary_Reader>) {
+    if (num_records < ed.count) {
+      throw PLY_Unexpected_End_Of_Data_Error();
+    }
+  }
+  std::pmr::vector<PLY_Property *> columns =
+      prepare_ply_columns(ed, num_records, reader.remaining(), parsed_ply, scratch);
+  if constexpr (std::is_same_v<Reader, PLY_Binary_Reader>) {
+    bool scalars_only = std::ranges::all_of(ed.property_definitions, [](const PLY_Property_Definition &pd) {
+      return pd.type == PLY_Property_Definition::Type::Scalar;
+    });
+    if (scalars_only && !ed.property_definitions.empty()) {
+      decode_ply_fixed_stride_element(ed, columns, reader);
+      return;
+    }
+    if (ed.property_definitions.size() == 1 && ed.property_definitions[0].type == PLY_Property_Definition::Type::List) {
+      const PLY_Property_Definition &pd = ed.property_definitions[0];
+      visit_ply_scalar_type(pd.count_type, [&](auto count_tag) {
+        using Count = decltype(count_tag);
+        if constexpr (std::is_floating_point_v<Count>) {
+          throw std::domain_error(std::format(R"(PLY list "{}" has a floating point count type)", pd.name));
+        } else {
+          visit_ply_scalar_type(pd.value_type, [&](auto value_tag) {
+            using T = decltype(value_tag);
+            if (reader.swaps_bytes()) {
+              decode_ply_list_element<Count, T, true>(ed, *columns[0], reader);
+            } else {
+              decode_ply_list_element<Count, T, false>(ed, *columns[0], reader);
+            }
+          });
+        }
+      });
+      return;
+    }
+  }
+  if (decode_ply_common_element(ed, columns, reader)) {
+    return;
+  }
+  std::pmr::vector<PLY_Decode_Op<Reader>> plan = compile_ply_decode_plan<Reader>(ed, columns, scratch);
+  for (size_t i = 0; i < ed.count; i++) {
+    for (const PLY_Decode_Op<Reader> &op : plan) {
+      op.decode(op, i, reader);
+    }
+  }
+}
+
+Parsed_PLY read_ply(std::span<const std::byte> bytes) {
+  Text_Cursor cursor(as_text(bytes));
+  std::string_view token;
+  cursor.next_token(); // expecting "ply"
+  cursor.next_token(); // expecting "format"
+  std::string_view format = cursor.next_token(); // expecting "ascii" or "binary_little_endian" or "binary_big_endian"
+  cursor.next_token();                           // expecting "1.0" or version number
+
+  std::array<std::byte, PLY_HEADER_ARENA_SIZE> header_buffer;
+  std::pmr::monotonic_buffer_resource header_arena(header_buffer.data(), header_buffer.size());
+  std::pmr::vector<PLY_Element_Definition> element_definitions(&header_arena);
+  while (token != "end_header") {
+    token = cursor.next_token();
+    if (token.empty()) {
+      throw std::domain_error("Expected \"end_header\" before the end of the PLY file");
+    } else if (token == "comment" || token == "obj_info") {
+      cursor.skip_line();
+    } else if (token == "element") {
+      PLY_Element_Definition ed{.property_definitions = std::pmr::vector<PLY_Property_Definition>(&header_arena)};
+      ed.name = cursor.next_token();
+      ed.count = cursor.next_number<size_t>();
+      element_definitions.push_back(std::move(ed));
+    } else if (token == "property") {
+      PLY_Property_Definition pd{.type = PLY_Property_Definition::Type::Scalar};
+      token = cursor.next_token();
+      if (token == "list") {
+        pd.type = PLY_Property_Definition::Type::List;
+        pd.count_type = parse_ply_scalar_type(cursor.next_token());
+        token = cursor.next_token();
+      }
+      pd.value_type = parse_ply_scalar_type(token);
+      pd.name = cursor.next_token();
+      if (element_definitions.empty()) {
+        throw PLY_Expected_Element_Definition_Error();
+      }
+      element_definitions.back().property_definitions.push_back(pd);
+    }
+  }
+  cursor.skip_line(); // The body starts right after the end of the "end_header" line
+  std::span<const std::byte> body = bytes.subspan(cursor.offset());
+
+  Parsed_PLY parsed_ply;
+  if (format == "ascii") {
+    Text_Cursor body_cursor(as_text(body), cursor.offset());
+    for (const PLY_Element_Definition &ed : element_definitions) {
+      decode_ply_element(ed, body_cursor, parsed_ply, &header_arena);
+    }
+  } else if (format == "binary_little_endian" || format == "binary_big_endian") {
+    PLY_Binary_Reader reader(body, format == "binary_little_endian" ? std::endian::little : std::endian::big);
+    for (const PLY_Element_Definition &ed : element_definitions) {
+      decode_ply_element(ed, reader, parsed_ply, &header_arena);
+    }
+  } else {
+    throw std::domain_error(std::format(R"(Unknown PLY format "{}")", format));
+  }
+  return parsed_ply;
+}
+
+constexpr size_t PLY_MIN_FACES_PER_THREAD = 1 << 14;
+
+// Scratch buffers of triangulate_polygon(), reused from one face to the next
+struct Polygon_Scratch {
+  std::vector<std::array<float, 2>> points; // Corners projected on the plane of the polygon
+  std::vector<uint32_t> remaining;          // Corners not clipped yet, as positions in the polygon
+};
+
+static float calc_cross_2d(const std::array<float, 2> &a, const std::array<float, 2> &b,
+                           const std::array<float, 2> &c) {
+  return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+/* Stores the corners.size() - 2 triangles of a polygon at `out`, keeping its winding order. Convex polygons are fanned
+ * from the first corner. Concave ones are ear clipped in the plane of the polygon, what is left when no ear can be
+ * found (self-intersecting or degenerate polygons) is fanned.
+ */
+static void triangulate_polygon(std::span<const Vec3f> vertices, std::span<const uint32_t> corners, uint32_t *out,
+                                Polygon_Scratch &scratch) {
+  auto store_triangle = [&](uint32_t a, uint32_t b, uint32_t c) {
+    out[0] = a;
+    out[1] = b;
+    out[2] = c;
+    out += 3;
+  };
+  auto dot = [](const Vec3f &a, const Vec3f &b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+  size_t n = corners.size();
+  Vec3f normal{0.0f, 0.0f, 0.0f}; // Newell's method, robust to collinear corners
+  for (size_t i = 0; i < n; i++) {
+    const Vec3f &a = vertices[corners[i]];
+    const Vec3f &b = vertices[corners[(i + 1) % n]];
+    normal = normal + Vec3f{(a.y - b.y) * (a.z + b.z), (a.z - b.z) * (a.x + b.x), (a.x - b.x) * (a.y + b.y)};
+  }
+  bool convex = true;
+  for (size_t i = 0; i < n && convex; i++) {
+    const Vec3f &a = vertices[corners[i]];
+    const Vec3f &b = vertices[corners[(i + 1) % n]];
+    const Vec3f &c = vertices[corners[(i + 2) % n]];
+    convex = dot((b - a).cross(c - b), normal) >= 0.0f;
+  }
+  if (convex) {
+    for (size_t i = 1; i + 1 < n; i++) {
+      store_triangle(corners[0], corners[i], corners[i + 1]);
+    }
+    return;
+  }
+
+  // Drops the dominant axis of the normal, the other two are taken in cyclic order so the polygon winds
+  // counter-clockwise in the plane when that normal component is positive
+  std::array<float, 3> abs_normal = {std::abs(normal.x), std::abs(normal.y), std::abs(normal.z)};
+  size_t axis = std::ranges::max_element(abs_normal) - abs_normal.begin();
+  float flip = std::array{normal.x, normal.y, normal.z}[axis] < 0.0f ? -1.0f : 1.0f;
+  scratch.points.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    const Vec3f &v = vertices[corners[i]];
+    std::array<float, 3> p = {v.x, v.y, v.z};
+    scratch.points[i] = {p[(axis + 1) % 3] * flip, p[(axis + 2) % 3]};
+  }
+  const std::vector<std::array<float, 2>> &points = scratch.points;
+  std::vector<uint32_t> &remaining = scratch.remaining;
+  remaining.resize(n);
+  std::iota(remaining.begin(), remaining.end(), uint32_t{0});
+  size_t i = 0;
+  for (size_t misses = 0; remaining.size() > 3 && misses < remaining.size();) {
+    size_t m = remaining.size();
+    uint32_t previous = remaining[(i + m - 1) % m];
+    uint32_t current = remaining[i];
+    uint32_t next = remaining[(i + 1) % m];
+    const auto &a = points[previous];
+    const auto &b = points[current];
+    const auto &c = points[next];
+    bool is_ear = calc_cross_2d(a, b, c) > 0.0f;
+    for (size_t j = 0; j < m && is_ear; j++) {
+      uint32_t other = remaining[j];
+      const auto &p = points[other];
+      is_ear = other == previous || other == current || other == next || calc_cross_2d(a, b, p) < 0.0f ||
+               calc_cross_2d(b, c, p) < 0.0f || calc_cross_2d(c, a, p) < 0.0f;
+    }
+    if (is_ear) {
+      store_triangle(corners[previous], corners[current], corners[next]);
+      remaining.erase(remaining.begin() + static_cast<ptrdiff_t>(i));
+      i %= remaining.size();
+      misses = 0;
+    } else {
+      i = (i + 1) % m;
+      misses++;
+    }
+  }
+  for (size_t j = 1; j + 1 < remaining.size(); j++) {
+    store_triangle(corners[remaining[0]], corners[remaining[j]], corners[remaining[j + 1]]);
+  }
+}
+
+void read_ply(std::span<const std::byte> bytes, Indexed_Mesh &mesh) {
+  Parsed_PLY parsed_ply = read_ply(bytes);
+  const PLY_Element &vertex_element = parsed_ply.elements_map.at("vertex");
+  // Properties are decoded as declared, so a list coordinate holds a different number of values than vertices
+  auto coordinates = [&](std::string_view name, std::vector<float> &storage) {
+    const PLY_Property &property = vertex_element.property_map.at(std::pmr::string(name));
+    if (!property.offsets.empty() || property.size() != vertex_element.count) {
+      throw std::domain_error(std::format(R"(Expected PLY vertex property "{}" to be a scalar)", name));
+    }
+    return property.values_as(storage);
+  };
+  std::vector<float> x_storage;
+  std::vector<float> y_storage;
+  std::vector<float> z_storage;
+  std::span<const float> xs = coordinates("x", x_storage);
+  std::span<const float> ys = coordinates("y", y_storage);
+  std::span<const float> zs = coordinates("z", z_storage);
+  size_t first_vertex = mesh.vertices.size();
+  mesh.vertices.resize(first_vertex + vertex_element.count);
+  for (size_t i = 0; i < vertex_element.count; i++) {
+    mesh.vertices[first_vertex + i] = {xs[i], ys[i], zs[i]};
+  }
+
+  const PLY_Element &face_element = parsed_ply.elements_map.at("face");
+  auto vertex_indices_it = face_element.property_map.find("vertex_indices");
+  if (vertex_indices_it == face_element.property_map.end()) {
+    vertex_indices_it = face_element.property_map.find("vertex_index");
+  }
+  if (vertex_indices_it == face_element.property_map.end()) {
+    throw std::out_of_range(R"(Could not find face property "vertex_index" nor "vertex_indices" in PLY file)");
+  }
+  const PLY_Property &vertex_indices_property = vertex_indices_it->second;
+  if (vertex_indices_property.offsets.size() != face_element.count + 1) {
+    throw std::domain_error(std::format(R"(Expected PLY face property "{}" to be a list)", vertex_indices_it->first));
+  }
+  std::vector<uint32_t> index_storage;
+  std::span<const uint32_t> all_vertex_indices = vertex_indices_property.values_as(index_storage);
+  // A face of n corners makes n - 2 triangles, so the list sizes tell where the triangles of each face go and the
+  // indices are allocated once, before faces are triangulated in parallel
+  std::vector<size_t> triangle_offsets(face_element.count + 1, 0);
+  for (size_t i = 0; i < face_element.count; i++) {
+    size_t face_size = vertex_indices_property.offsets[i + 1] - vertex_indices_property.offsets[i];
+    if (face_size < 3) {
+      throw std::domain_error(std::format("Expected face to have at least 3 vertices, but found {}", face_size));
+    }
+    triangle_offsets[i + 1] = triangle_offsets[i] + face_size - 2;
+  }
+  size_t first_index = mesh.indices.size();
+  mesh.indices.resize(first_index + triangle_offsets.back() * 3);
+  parallel_for(face_element.count, PLY_MIN_FACES_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    std::vector<uint32_t> corners;
+    Polygon_Scratch scratch;
+    for (size_t i = begin; i < end; i++) {
+      std::span<const uint32_t> vertex_indices = vertex_indices_property.list(all_vertex_indices, i);
+      uint32_t *out = mesh.indices.data() + first_index + triangle_offsets[i] * 3;
+      // Triangles are stored as they are read, polygons once all their corners are known
+      uint32_t *corner = out;
+      if (vertex_indices.size() != 3) {
+        corners.resize(vertex_indices.size());
+        corner = corners.data();
+      }
+      for (uint32_t vertex_index : vertex_indices) {
+        if (vertex_index >= vertex_element.count) {
+          throw std::out_of_range(std::format("Face {} references vertex {} but there are only {} vertices", i,
+                                              vertex_index, vertex_element.count));
+        }
+        *corner++ = static_cast<uint32_t>(first_vertex + vertex_index);
+      }
+      if (vertex_indices.size() != 3) {
+        triangulate_polygon(mesh.vertices, corners, out, scratch);
+      }
+    }
+  });
+}
+
+void read_ply(std::span<const std::byte> bytes, std::vector<Triangle> &triangles) {
+  Indexed_Mesh mesh;
+  read_ply(bytes, mesh);
+  append_triangle_soup(mesh, triangles);
+}
+
+void read_ply(std::span<const std::byte> bytes, const Triangle_Sink &sink) {
+  Indexed_Mesh mesh;
+  read_ply(bytes, mesh);
+  stream_triangle_soup(mesh, sink);
+}
+
+template <typename T>
+static void check_ply_vertex_attribute(std::span<const T> values, std::string_view name, size_t num_vertices) {
+  if (!values.empty() && values.size() != num_vertices) {
+    throw std::invalid_argument(std::format("Expected {} vertex {} but got {}", num_vertices, name, values.size()));
+  }
+}
+
+void write_binary_ply(const Indexed_Mesh &mesh, const std::filesystem::path &filepath,
+                      const PLY_Vertex_Attributes &attributes) {
+  size_t num_vertices = mesh.vertices.size();
+  check_ply_vertex_attribute(attributes.normals, "normals", num_vertices);
+  check_ply_vertex_attribute(attributes.colors, "colors", num_vertices);
+  bool has_normals = !attributes.normals.empty();
+  bool has_colors = !attributes.colors.empty();
+
+  std::string header = "ply\nformat binary_little_endian 1.0\ncomment meshproc\n";
+  header += std::format("element vertex {}\nproperty float x\nproperty float y\nproperty float z\n", num_vertices);
+  if (has_normals) {
+    header += "property float nx\nproperty float ny\nproperty float nz\n";
+  }
+  if (has_colors) {
+    header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+  }
+  header += std::format("element face {}\nproperty list uchar uint vertex_indices\nend_header\n", mesh.num_triangles());
+
+  std::ofstream ofs;
+  ofs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+  ofs.open(filepath, std::ofstream::binary);
+  ofs.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+  auto store_vec3f = [](char *dst, const Vec3f &v) {
+    store_little_endian(dst, v.x);
+    store_little_endian(dst + sizeof(float), v.y);
+    store_little_endian(dst + 2 * sizeof(float), v.z);
+  };
+  size_t vertex_size = sizeof(Vec3f) * (has_normals ? 2 : 1) + (has_colors ? 3 : 0);
+  write_records_in_batches(ofs, num_vertices, vertex_size, [&](size_t i, char *dst) {
+    store_vec3f(dst, mesh.vertices[i]);
+    dst += sizeof(Vec3f);
+    if (has_normals) {
+      store_vec3f(dst, attributes.normals[i]);
+      dst += sizeof(Vec3f);
+    }
+    if (has_colors) {
+      std::memcpy(dst, attributes.colors[i].data(), 3);
+    }
+  });
+
+  constexpr size_t face_size = sizeof(uint8_t) + 3 * sizeof(uint32_t);
+  write_records_in_batches(ofs, mesh.num_triangles(), face_size, [&](size_t i, char *dst) {
+    dst[0] = 3;
+    for (size_t j = 0; j < 3; j++) {
+      store_little_endian(dst + sizeof(uint8_t) + j * sizeof(uint32_t), mesh.indices[i * 3 + j]);
+    }
+  });
+}
+
+} // namespace meshproc
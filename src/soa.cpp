@@ -0,0 +1,105 @@
+#include "internal.hpp"
+
+namespace meshproc {
+
+SoA_Vec3_Array to_soa(std::span<const Vec3f> vertices) {
+  SoA_Vec3_Array soa;
+  soa.resize(vertices.size());
+  parallel_for(vertices.size(), SOA_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    for (size_t i = begin; i < end; i++) {
+      soa.set(i, vertices[i]);
+    }
+  });
+  return soa;
+}
+
+SoA_Triangles to_soa(std::span<const Triangle> triangles) {
+  SoA_Triangles soa;
+  soa.resize(triangles.size());
+  parallel_for(triangles.size(), SOA_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    for (size_t i = begin; i < end; i++) {
+      for (size_t j = 0; j < 3; j++) {
+        soa.corners[j].set(i, triangles[i].vertices[j]);
+      }
+      soa.normals.set(i, triangles[i].normal);
+    }
+  });
+  return soa;
+}
+
+void to_aos(const SoA_Triangles &soa, std::vector<Triangle> &triangles) {
+  triangles.resize(soa.size());
+  parallel_for(soa.size(), SOA_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    for (size_t i = begin; i < end; i++) {
+      triangles[i] = {soa.normals[i], {soa.corners[0][i], soa.corners[1][i], soa.corners[2][i]}};
+    }
+  });
+}
+
+// SSE2 is part of x86-64, so it needs no runtime check. Compilers only vectorize float min/max with -ffast-math
+static void calc_bounds(const float *values, size_t begin, size_t end, float &min, float &max) {
+  size_t i = begin;
+#ifdef MESHPROC_HAS_SSE2
+  constexpr size_t SSE_WIDTH = 4;
+  if (end - begin >= SSE_WIDTH) {
+    __m128 lane_min = _mm_set1_ps(min);
+    __m128 lane_max = _mm_set1_ps(max);
+    for (; i + SSE_WIDTH <= end; i += SSE_WIDTH) {
+      __m128 v = _mm_loadu_ps(values + i);
+      lane_min = _mm_min_ps(lane_min, v);
+      lane_max = _mm_max_ps(lane_max, v);
+    }
+    alignas(16) std::array<float, SSE_WIDTH> mins;
+    alignas(16) std::array<float, SSE_WIDTH> maxs;
+    _mm_store_ps(mins.data(), lane_min);
+    _mm_store_ps(maxs.data(), lane_max);
+    min = *std::ranges::min_element(mins);
+    max = *std::ranges::max_element(maxs);
+  }
+#endif
+  for (; i < end; i++) {
+    min = std::min(min, values[i]);
+    max = std::max(max, values[i]);
+  }
+}
+
+Bounds calc_bounds(const SoA_Vec3_Array &points) {
+  std::vector<Bounds> thread_bounds(calc_num_threads());
+  parallel_for(points.size(), SOA_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t thread_index) {
+    Bounds &b = thread_bounds[thread_index];
+    calc_bounds(points.x.data(), begin, end, b.min.x, b.max.x);
+    calc_bounds(points.y.data(), begin, end, b.min.y, b.max.y);
+    calc_bounds(points.z.data(), begin, end, b.min.z, b.max.z);
+  });
+  Bounds bounds;
+  for (const Bounds &b : thread_bounds) {
+    bounds.extend(b);
+  }
+  return bounds;
+}
+
+Bounds calc_bounds(const SoA_Triangles &triangles) {
+  Bounds bounds;
+  for (const SoA_Vec3_Array &corner : triangles.corners) {
+    bounds.extend(calc_bounds(corner));
+  }
+  return bounds;
+}
+
+void apply_transform(SoA_Vec3_Array &points, const Affine_Transform &m) {
+  parallel_for(points.size(), SOA_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    float *xs = points.x.data();
+    float *ys = points.y.data();
+    float *zs = points.z.data();
+    for (size_t i = begin; i < end; i++) {
+      float x = xs[i];
+      float y = ys[i];
+      float z = zs[i];
+      xs[i] = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
+      ys[i] = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
+      zs[i] = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3];
+    }
+  });
+}
+
+} // namespace meshproc
@@ -0,0 +1,355 @@
+#include "internal.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <memory> // std::make_unique_for_overwrite
+
+namespace meshproc {
+
+static void read_binary_stl(uint32_t num_triangles, std::ifstream &ifs, std::vector<Triangle> &triangles) {
+  triangles.reserve(triangles.size() + num_triangles);
+  for (uint32_t i = 0; i < num_triangles; ++i) {
+    Triangle t;
+    ifs.read((char *)&t, sizeof(Triangle));
+    triangles.push_back(t);
+    uint16_t attribute_byte_count;
+    ifs.read((char *)&attribute_byte_count, sizeof(uint16_t));
+  }
+}
+
+static void read_ascii_stl(std::ifstream &ifs, std::vector<Triangle> &triangles) {
+  while (ifs.good()) {
+    std::string token;
+    ifs >> token;
+    if (token == "facet") {
+      Triangle t;
+      ifs >> token; // expecting "normal"
+      ifs >> t.normal.x >> t.normal.y >> t.normal.z;
+      ifs >> token; // expecting "outer"
+      ifs >> token; // expecting "loop"
+      for (int i = 0; i < 3; i++) {
+        ifs >> token; // expecting "vertex"
+        ifs >> t.vertices[i].x >> t.vertices[i].y >> t.vertices[i].z;
+      }
+      ifs >> token; // expecting "endloop"
+      ifs >> token; // expecting "endfacet"
+      triangles.push_back(t);
+    }
+  }
+}
+
+static size_t calc_file_size(std::ifstream &ifs) {
+  auto original_pos = ifs.tellg();
+  ifs.seekg(0, std::ifstream::end);
+  auto end = ifs.tellg();
+  ifs.seekg(0, std::ifstream::beg);
+  size_t file_size = end - ifs.tellg();
+  ifs.seekg(original_pos, std::ifstream::beg);
+  return file_size;
+}
+
+void read_stl(std::ifstream &ifs, std::vector<Triangle> &triangles) {
+  size_t file_size = calc_file_size(ifs);
+  if (file_size == 0) {
+    std::cout << "Empty file" << std::endl;
+    return;
+  }
+  ifs.seekg(BINARY_STL_HEADER_SIZE, std::ifstream::beg); // Seek right past the header
+
+  uint32_t num_triangles = 0;
+  ifs.read((char *)&num_triangles, sizeof(uint32_t));
+
+  if (file_size ==
+      (BINARY_STL_HEADER_SIZE + sizeof(uint32_t) + num_triangles * (sizeof(Triangle) + sizeof(uint16_t)))) {
+    read_binary_stl(num_triangles, ifs, triangles);
+  } else {
+    ifs.seekg(0, std::ifstream::beg);
+    read_ascii_stl(ifs, triangles);
+  }
+}
+
+// ASCII STL files smaller than this are parsed on the calling thread
+constexpr size_t ASCII_STL_MIN_CHUNK_SIZE = 1 << 20;
+// Text parsed by each thread before the triangles are handed over, bounds the memory held by parsed triangles
+constexpr size_t ASCII_STL_MAX_CHUNK_SIZE = 16 << 20;
+
+// Finds the first "facet" keyword at or after `pos`, skipping the tail of "endfacet"
+static size_t find_facet_keyword(std::string_view text, size_t pos) {
+  constexpr std::string_view keyword = "facet";
+  for (pos = text.find(keyword, pos); pos != std::string_view::npos; pos = text.find(keyword, pos + 1)) {
+    size_t end = pos + keyword.size();
+    if ((pos == 0 || is_space(text[pos - 1])) && (end == text.size() || is_space(text[end]))) {
+      return pos;
+    }
+  }
+  return text.size();
+}
+
+static void parse_ascii_stl_chunk(std::string_view chunk, size_t chunk_offset, std::vector<Triangle> &triangles) {
+  Text_Cursor cursor(chunk, chunk_offset);
+  for (std::string_view token = cursor.next_token(); !token.empty(); token = cursor.next_token()) {
+    if (token == "facet") {
+      Triangle &t = triangles.emplace_back();
+      cursor.next_token(); // expecting "normal"
+      t.normal = cursor.next_vec3f();
+      cursor.next_token(); // expecting "outer"
+      cursor.next_token(); // expecting "loop"
+      for (Vec3f &v : t.vertices) {
+        cursor.next_token(); // expecting "vertex"
+        v = cursor.next_vec3f();
+      }
+      cursor.next_token(); // expecting "endloop"
+      cursor.next_token(); // expecting "endfacet"
+    }
+  }
+}
+
+/* Parses the text one window of up to ASCII_STL_MAX_CHUNK_SIZE bytes per thread at a time, and calls
+ * f(window_chunks) with the triangles of every chunk of the window, in file order. `base_offset` is the position of
+ * `text` in the file, only used for error messages.
+ */
+template <typename F> static void parse_ascii_stl_windows(std::string_view text, size_t base_offset, F &&f) {
+  size_t max_window_size = calc_num_threads() * ASCII_STL_MAX_CHUNK_SIZE;
+  std::vector<std::vector<Triangle>> chunk_triangles;
+  std::vector<size_t> chunk_begins;
+  for (size_t window_begin = 0; window_begin < text.size();) {
+    size_t window_end =
+        text.size() - window_begin > max_window_size ? find_facet_keyword(text, window_begin + max_window_size)
+                                                     : text.size();
+    size_t window_size = window_end - window_begin;
+    size_t num_chunks = std::clamp(window_size / ASCII_STL_MIN_CHUNK_SIZE, size_t{1}, calc_num_threads());
+    chunk_begins.assign(num_chunks + 1, window_end);
+    chunk_begins[0] = window_begin;
+    for (size_t i = 1; i < num_chunks; i++) {
+      chunk_begins[i] =
+          find_facet_keyword(text, std::max(chunk_begins[i - 1], window_begin + window_size * i / num_chunks));
+    }
+
+    chunk_triangles.resize(num_chunks); // Chunk vectors keep their capacity from one window to the next
+    parallel_for(num_chunks, 1, [&](size_t begin, size_t end, size_t) {
+      for (size_t i = begin; i < end; i++) {
+        std::string_view chunk = text.substr(chunk_begins[i], chunk_begins[i + 1] - chunk_begins[i]);
+        chunk_triangles[i].clear();
+        chunk_triangles[i].reserve(chunk.size() / 256); // A typical facet takes a bit more than 256 bytes
+        parse_ascii_stl_chunk(chunk, base_offset + chunk_begins[i], chunk_triangles[i]);
+      }
+    });
+    f(std::span<const std::vector<Triangle>>(chunk_triangles));
+    window_begin = window_end;
+  }
+}
+
+void read_ascii_stl(std::string_view text, std::vector<Triangle> &triangles) {
+  parse_ascii_stl_windows(text, 0, [&](std::span<const std::vector<Triangle>> window_chunks) {
+    size_t num_triangles = triangles.size();
+    for (const std::vector<Triangle> &chunk : window_chunks) {
+      num_triangles += chunk.size();
+    }
+    triangles.reserve(num_triangles);
+    for (const std::vector<Triangle> &chunk : window_chunks) {
+      triangles.insert(triangles.end(), chunk.begin(), chunk.end());
+    }
+  });
+}
+
+void read_ascii_stl(std::string_view text, const Triangle_Sink &sink) {
+  Triangle_Batcher batcher(sink);
+  parse_ascii_stl_windows(text, 0, [&](std::span<const std::vector<Triangle>> window_chunks) {
+    for (const std::vector<Triangle> &chunk : window_chunks) {
+      batcher.append(chunk);
+    }
+  });
+  batcher.flush();
+}
+
+void read_binary_stl(const Binary_STL_View &view, const Triangle_Sink &sink) {
+  std::vector<Triangle> batch(std::min(view.size(), TRIANGLE_BATCH_SIZE));
+  for (size_t batch_begin = 0; batch_begin < view.size(); batch_begin += TRIANGLE_BATCH_SIZE) {
+    size_t batch_size = std::min(TRIANGLE_BATCH_SIZE, view.size() - batch_begin);
+    for (size_t i = 0; i < batch_size; i++) {
+      batch[i] = view[batch_begin + i];
+    }
+    sink(std::span(batch).first(batch_size));
+  }
+}
+
+void read_stl(std::span<const std::byte> bytes, std::vector<Triangle> &triangles) {
+  if (bytes.empty()) {
+    std::cout << "Empty file" << std::endl;
+    return;
+  }
+  if (auto view = Binary_STL_View::from_bytes(bytes)) {
+    view->unpack(triangles);
+  } else {
+    read_ascii_stl(as_text(bytes), triangles);
+  }
+}
+
+void read_stl(std::span<const std::byte> bytes, const Triangle_Sink &sink) {
+  if (bytes.empty()) {
+    std::cout << "Empty file" << std::endl;
+    return;
+  }
+  if (auto view = Binary_STL_View::from_bytes(bytes)) {
+    read_binary_stl(*view, sink);
+  } else {
+    read_ascii_stl(as_text(bytes), sink);
+  }
+}
+
+// Last "facet" keyword followed by a whitespace, so it is not cut at the end of the text. 0 when there is none
+static size_t find_last_facet_keyword(std::string_view text) {
+  constexpr std::string_view keyword = "facet";
+  for (size_t pos = text.rfind(keyword); pos != std::string_view::npos && pos > 0; pos = text.rfind(keyword, pos - 1)) {
+    size_t end = pos + keyword.size();
+    if (is_space(text[pos - 1]) && end < text.size() && is_space(text[end])) {
+      return pos;
+    }
+  }
+  return 0;
+}
+
+/* Decompressed data is appended to a pending buffer as it arrives. Whatever it holds of complete records or facets is
+ * parsed while the next chunks are being decompressed, the incomplete tail waits for the next chunk.
+ */
+void read_stl(Decompressing_Reader &reader, const Triangle_Sink &sink) {
+  std::span<const std::byte> prefix = reader.peek();
+  if (prefix.empty()) {
+    std::cout << "Empty file" << std::endl;
+    return;
+  }
+  Input_Format format = detect_streamed_input_format(prefix);
+  if (format != Input_Format::Binary_STL && format != Input_Format::ASCII_STL) {
+    throw std::domain_error("Expected STL data");
+  }
+  Triangle_Batcher batcher(sink);
+  std::vector<std::byte> chunk;
+  if (format == Input_Format::Binary_STL) {
+    std::vector<std::byte> pending;
+    std::vector<Triangle> triangles;
+    std::optional<uint32_t> declared_triangles; // Read from the header once it arrived
+    size_t num_triangles = 0;
+    while (reader.next_chunk(chunk)) {
+      pending.insert(pending.end(), chunk.begin(), chunk.end());
+      size_t pos = 0;
+      if (!declared_triangles) {
+        if (pending.size() < BINARY_STL_HEADER_SIZE + sizeof(uint32_t)) {
+          continue;
+        }
+        declared_triangles.emplace();
+        std::memcpy(&*declared_triangles, pending.data() + BINARY_STL_HEADER_SIZE, sizeof(uint32_t));
+        pos = BINARY_STL_HEADER_SIZE + sizeof(uint32_t);
+      }
+      triangles.resize((pending.size() - pos) / BINARY_STL_RECORD_SIZE);
+      for (size_t i = 0; i < triangles.size(); i++) {
+        std::memcpy(&triangles[i], pending.data() + pos + i * BINARY_STL_RECORD_SIZE, sizeof(Triangle));
+      }
+      batcher.append(triangles);
+      num_triangles += triangles.size();
+      pending.erase(pending.begin(), pending.begin() + pos + triangles.size() * BINARY_STL_RECORD_SIZE);
+    }
+    batcher.flush();
+    // The size check of the mapped readers can only be done at the end, once all the triangles were delivered
+    if (!declared_triangles || num_triangles != *declared_triangles || !pending.empty()) {
+      throw std::domain_error(std::format("Binary STL declares {} triangles but holds {} bytes of records",
+                                          declared_triangles.value_or(0),
+                                          num_triangles * BINARY_STL_RECORD_SIZE + pending.size()));
+    }
+  } else {
+    std::string pending;
+    size_t pending_offset = 0; // Position of `pending` in the data
+    auto parse_text = [&](std::string_view text) {
+      parse_ascii_stl_windows(text, pending_offset, [&](std::span<const std::vector<Triangle>> window_chunks) {
+        for (const std::vector<Triangle> &chunk_triangles : window_chunks) {
+          batcher.append(chunk_triangles);
+        }
+      });
+    };
+    // Enough text for every thread to get a chunk of its own
+    size_t min_text_size = calc_num_threads() * ASCII_STL_MIN_CHUNK_SIZE;
+    while (reader.next_chunk(chunk)) {
+      pending.append(as_text(chunk));
+      if (pending.size() >= min_text_size) {
+        size_t end = find_last_facet_keyword(pending);
+        parse_text(std::string_view(pending).substr(0, end));
+        pending.erase(0, end);
+        pending_offset += end;
+      }
+    }
+    parse_text(pending);
+    batcher.flush();
+  }
+}
+
+std::string make_binary_stl_header(std::string_view description, size_t num_triangles) {
+  if (num_triangles > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error(std::format("Binary STL cannot hold {} triangles", num_triangles));
+  }
+  std::string header(description.substr(0, BINARY_STL_HEADER_SIZE));
+  header.resize(BINARY_STL_HEADER_SIZE, ' ');
+  append_little_endian(header, static_cast<uint32_t>(num_triangles));
+  return header;
+}
+
+void store_binary_stl_record(char *dst, const Triangle &t) {
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(dst, &t, sizeof(Triangle));
+  } else {
+    char *field = dst;
+    for (const Vec3f &v : {t.normal, t.vertices[0], t.vertices[1], t.vertices[2]}) {
+      store_little_endian(field, v.x);
+      store_little_endian(field + sizeof(float), v.y);
+      store_little_endian(field + 2 * sizeof(float), v.z);
+      field += sizeof(Vec3f);
+    }
+  }
+  store_little_endian(dst + sizeof(Triangle), uint16_t{0});
+}
+
+void append_ascii_stl_facet(std::string &out, const Triangle &t) {
+  out += "facet normal ";
+  append_vec3f(out, t.normal);
+  out += "\n outer loop\n";
+  for (const Vec3f &v : t.vertices) {
+    out += "  vertex ";
+    append_vec3f(out, v);
+    out += '\n';
+  }
+  out += " endloop\nendfacet\n";
+}
+
+/* The whole file is formatted into one buffer, records in parallel, then written at once. A binary STL is about as
+ * large as the triangles themselves, so this does not change the order of magnitude of the memory use.
+ */
+void write_binary_stl(std::span<const Triangle> triangles, const std::filesystem::path &filepath) {
+  std::string header = make_binary_stl_header("meshproc", triangles.size());
+  size_t file_size = header.size() + triangles.size() * BINARY_STL_RECORD_SIZE;
+  auto buffer = std::make_unique_for_overwrite<char[]>(file_size);
+  std::memcpy(buffer.get(), header.data(), header.size());
+  char *records = buffer.get() + header.size();
+  parallel_for(triangles.size(), WRITER_MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    for (size_t i = begin; i < end; i++) {
+      store_binary_stl_record(records + i * BINARY_STL_RECORD_SIZE, triangles[i]);
+    }
+  });
+
+  std::ofstream ofs;
+  ofs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+  ofs.open(filepath, std::ofstream::binary);
+  ofs.write(buffer.get(), static_cast<std::streamsize>(file_size));
+}
+
+void write_ascii_stl(std::span<const Triangle> triangles, const std::filesystem::path &filepath) {
+  std::ofstream ofs;
+  ofs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+  ofs.open(filepath, std::ofstream::binary);
+  ofs << "solid meshproc\n";
+  write_in_batches(ofs, triangles.size(), [&](size_t begin, size_t end, std::string &out) {
+    for (size_t i = begin; i < end; i++) {
+      append_ascii_stl_facet(out, triangles[i]);
+    }
+  });
+  ofs << "endsolid meshproc\n";
+}
+
+} // namespace meshproc
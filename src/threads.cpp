@@ -0,0 +1,19 @@
+#include "internal.hpp"
+
+namespace meshproc {
+
+// 0 while the thread has no Scoped_Thread_Limit
+static thread_local size_t max_threads = 0;
+
+Scoped_Thread_Limit::Scoped_Thread_Limit(size_t limit) : previous_max_threads_(max_threads) {
+  max_threads = std::max(limit, size_t{1});
+}
+
+Scoped_Thread_Limit::~Scoped_Thread_Limit() { max_threads = previous_max_threads_; }
+
+size_t calc_num_threads() {
+  size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+  return max_threads > 0 ? std::min(num_threads, max_threads) : num_threads;
+}
+
+} // namespace meshproc
@@ -0,0 +1,193 @@
+#include "internal.hpp"
+
+#include <numeric> // std::partial_sum
+#include <utility> // std::exchange
+
+namespace meshproc {
+
+/* Vertex welding
+ *
+ * Corners at the same position are merged first: every corner gets the bit pattern of its position as key, corners
+ * are bucketed by key hash into shards, and each shard is processed by a single thread with its own hash map, so no
+ * locking is needed. Within a shard corners are visited in file order, which keeps the result deterministic: corners
+ * are merged into the first matching corner and vertices are numbered in order of first occurrence.
+ *
+ * With an epsilon, each distinct position is then merged into the earliest vertex within epsilon, found in the grid
+ * cells around it. Vertices are the positions that were not merged themselves, so every corner stays
+ * within epsilon of its vertex instead of drifting along chains of merges.
+ */
+
+constexpr size_t WELD_NUM_SHARDS = 256;
+constexpr size_t WELD_MIN_CORNERS_PER_THREAD = 1 << 16;
+
+using Weld_Key = std::array<int64_t, 3>;
+
+struct Weld_Key_Hash {
+  size_t operator()(const Weld_Key &key) const {
+    return mix_bits(static_cast<uint64_t>(key[0]) ^
+                    mix_bits(static_cast<uint64_t>(key[1]) ^ mix_bits(static_cast<uint64_t>(key[2]))));
+  }
+};
+
+static size_t calc_weld_shard(const Weld_Key &key) { return Weld_Key_Hash{}(key) >> 56; }
+static_assert(WELD_NUM_SHARDS == 256, "calc_weld_shard() uses the top 8 bits of the hash");
+
+// Vertex of the epsilon pass, chained to the previous vertex of the same grid cell
+struct Weld_Cell_Vertex {
+  uint32_t corner;
+  uint32_t previous;
+};
+constexpr uint32_t WELD_NO_CELL_VERTEX = std::numeric_limits<uint32_t>::max();
+
+Indexed_Mesh weld_vertices(std::span<const Triangle> triangles, float epsilon) {
+  size_t num_corners = triangles.size() * 3;
+  if (num_corners > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error(std::format("Cannot index {} triangle corners with 32 bits indices", num_corners));
+  }
+  auto corner_position = [&](size_t corner) -> const Vec3f & { return triangles[corner / 3].vertices[corner % 3]; };
+  auto position_key_of = [](const Vec3f &p) -> Weld_Key {
+    // Adding zero turns -0.0 into +0.0, so both get the same bit pattern
+    return {std::bit_cast<uint32_t>(p.x + 0.0f), std::bit_cast<uint32_t>(p.y + 0.0f),
+            std::bit_cast<uint32_t>(p.z + 0.0f)};
+  };
+  // Grid cells of the epsilon pass, twice as wide as epsilon so that a sphere of radius epsilon overlaps 2 cells per
+  // axis (3 only when it is right on a cell boundary)
+  float cell_size = 2.0f * epsilon;
+  auto cell_of = [&](const Vec3f &p) -> Weld_Key {
+    return {static_cast<int64_t>(std::floor(p.x / cell_size)), static_cast<int64_t>(std::floor(p.y / cell_size)),
+            static_cast<int64_t>(std::floor(p.z / cell_size))};
+  };
+
+  // Stable counting sort of corners by shard, each block of corners is counted then scattered by one thread
+  size_t num_blocks = std::clamp(num_corners / WELD_MIN_CORNERS_PER_THREAD, size_t{1}, calc_num_threads());
+  auto block_begin = [&](size_t block) { return num_corners * block / num_blocks; };
+  std::vector<uint8_t> corner_shards(num_corners);
+  std::vector<std::array<size_t, WELD_NUM_SHARDS>> block_offsets(num_blocks);
+  parallel_for(num_blocks, 1, [&](size_t begin, size_t end, size_t) {
+    for (size_t block = begin; block < end; block++) {
+      block_offsets[block].fill(0);
+      for (size_t corner = block_begin(block); corner < block_begin(block + 1); corner++) {
+        corner_shards[corner] = static_cast<uint8_t>(calc_weld_shard(position_key_of(corner_position(corner))));
+        block_offsets[block][corner_shards[corner]]++;
+      }
+    }
+  });
+  std::array<size_t, WELD_NUM_SHARDS + 1> shard_begins{};
+  size_t running_offset = 0;
+  for (size_t shard = 0; shard < WELD_NUM_SHARDS; shard++) {
+    shard_begins[shard] = running_offset;
+    for (std::array<size_t, WELD_NUM_SHARDS> &offsets : block_offsets) {
+      running_offset += std::exchange(offsets[shard], running_offset);
+    }
+  }
+  shard_begins[WELD_NUM_SHARDS] = running_offset;
+  std::vector<uint32_t> sorted_corners(num_corners);
+  parallel_for(num_blocks, 1, [&](size_t begin, size_t end, size_t) {
+    for (size_t block = begin; block < end; block++) {
+      for (size_t corner = block_begin(block); corner < block_begin(block + 1); corner++) {
+        sorted_corners[block_offsets[block][corner_shards[corner]]++] = static_cast<uint32_t>(corner);
+      }
+    }
+  });
+  corner_shards = {};
+
+  // Representative of every corner: the corner it gets merged into, always at or before itself
+  std::vector<uint32_t> representatives(num_corners);
+  parallel_for(WELD_NUM_SHARDS, 1, [&](size_t begin, size_t end, size_t) {
+    for (size_t shard = begin; shard < end; shard++) {
+      std::span<const uint32_t> corners(sorted_corners.data() + shard_begins[shard],
+                                        sorted_corners.data() + shard_begins[shard + 1]);
+      std::unordered_map<Weld_Key, uint32_t, Weld_Key_Hash> first_corners;
+      first_corners.reserve(corners.size());
+      for (uint32_t corner : corners) {
+        Weld_Key key = position_key_of(corner_position(corner));
+        representatives[corner] = first_corners.try_emplace(key, corner).first->second;
+      }
+    }
+  });
+
+  if (epsilon > 0.0f) {
+    // Whether a position makes a vertex depends on every earlier vertex, so this pass runs in file order on one thread,
+    // over distinct positions only. Duplicates follow the representative found before them
+    size_t num_positions = 0;
+    for (size_t corner = 0; corner < num_corners; corner++) {
+      num_positions += representatives[corner] == corner;
+    }
+    std::unordered_map<Weld_Key, uint32_t, Weld_Key_Hash> cell_last_vertices;
+    cell_last_vertices.reserve(num_positions);
+    std::vector<Weld_Cell_Vertex> cell_vertices;
+    cell_vertices.reserve(num_positions);
+    float epsilon_squared = epsilon * epsilon;
+    Vec3f search_reach = Vec3f{epsilon, epsilon, epsilon} * 1.001f;
+    for (size_t corner = 0; corner < num_corners; corner++) {
+      if (representatives[corner] != corner) {
+        representatives[corner] = representatives[representatives[corner]];
+        continue;
+      }
+      const Vec3f &p = corner_position(corner);
+      // Cells overlapped by the sphere of radius epsilon, with a reach a little longer than epsilon so that rounding
+      // cannot leave out a cell
+      Weld_Key first_cell = cell_of(p - search_reach);
+      Weld_Key last_cell = cell_of(p + search_reach);
+      auto representative = static_cast<uint32_t>(corner);
+      for (int64_t x = first_cell[0]; x <= last_cell[0]; x++) {
+        for (int64_t y = first_cell[1]; y <= last_cell[1]; y++) {
+          for (int64_t z = first_cell[2]; z <= last_cell[2]; z++) {
+            auto it = cell_last_vertices.find({x, y, z});
+            if (it == cell_last_vertices.end()) {
+              continue;
+            }
+            // Vertices are more than epsilon apart, so a cell only holds a few of them
+            for (uint32_t i = it->second; i != WELD_NO_CELL_VERTEX; i = cell_vertices[i].previous) {
+              uint32_t other = cell_vertices[i].corner;
+              Vec3f d = corner_position(other) - p;
+              if (other < representative && d.x * d.x + d.y * d.y + d.z * d.z <= epsilon_squared) {
+                representative = other;
+              }
+            }
+          }
+        }
+      }
+      representatives[corner] = representative;
+      if (representative == corner) {
+        uint32_t &last_vertex = cell_last_vertices.try_emplace(cell_of(p), WELD_NO_CELL_VERTEX).first->second;
+        cell_vertices.push_back({representative, last_vertex});
+        last_vertex = static_cast<uint32_t>(cell_vertices.size() - 1);
+      }
+    }
+  }
+
+  // Number vertices in order of first occurrence, then point every corner at its representative's vertex
+  Indexed_Mesh mesh;
+  std::vector<uint32_t> vertex_ids(num_corners);
+  std::vector<size_t> block_first_vertex(num_blocks + 1, 0);
+  parallel_for(num_blocks, 1, [&](size_t begin, size_t end, size_t) {
+    for (size_t block = begin; block < end; block++) {
+      for (size_t corner = block_begin(block); corner < block_begin(block + 1); corner++) {
+        block_first_vertex[block + 1] += representatives[corner] == corner;
+      }
+    }
+  });
+  std::partial_sum(block_first_vertex.begin(), block_first_vertex.end(), block_first_vertex.begin());
+  mesh.vertices.resize(block_first_vertex[num_blocks]);
+  parallel_for(num_blocks, 1, [&](size_t begin, size_t end, size_t) {
+    for (size_t block = begin; block < end; block++) {
+      size_t vertex_id = block_first_vertex[block];
+      for (size_t corner = block_begin(block); corner < block_begin(block + 1); corner++) {
+        if (representatives[corner] == corner) {
+          mesh.vertices[vertex_id] = corner_position(corner);
+          vertex_ids[corner] = static_cast<uint32_t>(vertex_id++);
+        }
+      }
+    }
+  });
+  mesh.indices.resize(num_corners);
+  parallel_for(num_corners, WELD_MIN_CORNERS_PER_THREAD, [&](size_t begin, size_t end, size_t) {
+    for (size_t corner = begin; corner < end; corner++) {
+      mesh.indices[corner] = vertex_ids[representatives[corner]];
+    }
+  });
+  return mesh;
+}
+
+} // namespace meshproc